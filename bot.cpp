@@ -0,0 +1,421 @@
+#include "bot.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <utility>
+
+
+// Feature weights, tuned by hand against tetris_sim
+constexpr double AGGREGATE_HEIGHT_WEIGHT {-0.51};
+constexpr double LINES_CLEARED_WEIGHT {0.76};
+constexpr double HOLES_WEIGHT {-0.36};
+constexpr double BUMPINESS_WEIGHT {-0.18};
+constexpr double WELLS_WEIGHT {-0.10};
+
+
+double evaluateField(const Field& field, const int numLinesCleared)
+{
+	// Height of each column above the floor, walls included
+	const StackProfile& profile = field.getProfile();
+	std::array<int, FIELD_WIDTH> heights {};
+	for (int x = 1; x < FIELD_WIDTH - 1; x++)
+		heights[x] = profile.columnHeights[x];
+	heights[0] = FIELD_HEIGHT;
+	heights[FIELD_WIDTH - 1] = FIELD_HEIGHT;
+	const int holes = profile.holes;
+
+	// Kept free of branches so that the compiler can vectorize them
+	int aggregateHeight {0};
+	int wells {0};
+	for (int x = 1; x < FIELD_WIDTH - 1; x++)
+	{
+		aggregateHeight += heights[x];
+
+		// A well is a column lower than both of its neighbours
+		const int rim = std::min(heights[x - 1], heights[x + 1]);
+		wells += std::max(rim - heights[x], 0);
+	}
+
+	int bumpiness {0};
+	for (int x = 1; x < FIELD_WIDTH - 2; x++)
+		bumpiness += std::abs(heights[x] - heights[x + 1]);
+
+	return (AGGREGATE_HEIGHT_WEIGHT * aggregateHeight) +
+		(HOLES_WEIGHT * holes) +
+		(BUMPINESS_WEIGHT * bumpiness) +
+		(WELLS_WEIGHT * wells) +
+		(LINES_CLEARED_WEIGHT * numLinesCleared);
+}
+
+
+bool coversSameCells(const int tnum, const Placement& a, const Placement& b)
+{
+	const PieceMask& maskA = pieceMasks[tnum][a.rot];
+	const PieceMask& maskB = pieceMasks[tnum][b.rot];
+	return canonicalRotations[tnum][a.rot] == canonicalRotations[tnum][b.rot] &&
+		a.x + maskA.left == b.x + maskB.left &&
+		a.y + maskA.top == b.y + maskB.top;
+}
+
+
+// The piece falls the rest of the way with a single hard drop
+void trimTrailingDrops(std::vector<Action>& path)
+{
+	while (!path.empty() && path.back() == Action::SoftDrop)
+		path.pop_back();
+}
+
+
+// Every placement reached by turning and sliding at the top and then
+// dropping straight down. Pieces further ahead are placed this way only,
+// since whether a tuck can be made in time depends on the gravity then.
+void findDropPlacements(const Field& field, const Tetromino& start,
+	std::vector<Placement>& placements)
+{
+	placements.clear();
+	Tetromino dropped {start};
+	for (int rot = 0; rot < 4; rot++)
+	{
+		// Rotations with the same shape would give the same placements
+		if (canonicalRotations[start.tnum][rot] != rot)
+			continue;
+
+		const PieceMask& mask = pieceMasks[start.tnum][rot];
+		dropped.rot = rot;
+		dropped.y = start.y;
+		for (dropped.x = -mask.left; dropped.x + mask.right < FIELD_WIDTH; dropped.x++)
+		{
+			if (!pieceCanFit(field, dropped))
+				continue;
+			placements.push_back(Placement{dropped.x, getLandingRow(field, dropped), rot});
+		}
+	}
+}
+
+
+// Rotate in place, then slide sideways to the placement's column.
+// The hard drop at the end of every path takes it the rest of the way.
+std::vector<Action> getDirectPath(const Field& field, const Tetromino& start,
+	const Placement& placement)
+{
+	std::vector<Action> directPath;
+	Tetromino moved {start};
+	// Three clockwise turns are one counterclockwise turn
+	const int numTurns = (placement.rot - start.rot + 4) % 4;
+	const bool turnLeft = (numTurns == 3);
+	for (int i = 0; i < (turnLeft ? 1 : numTurns); i++)
+	{
+		tryRotate(field, moved, turnLeft ? (moved.rot + 3) % 4 : (moved.rot + 1) % 4);
+		directPath.push_back(turnLeft ? Action::RotateCCW : Action::RotateCW);
+	}
+
+	const Action slide = (placement.x < moved.x) ? Action::Left : Action::Right;
+	for (int i = 0; i < std::abs(placement.x - moved.x); i++)
+		directPath.push_back(slide);
+	return directPath;
+}
+
+
+// Press the path's actions and then a hard drop on a copy of the game,
+// one per frame, and report whether the piece locks at the placement.
+// Gravity keeps pulling the piece down meanwhile, and it locks as soon
+// as it cannot fall, so a path that moves it along the stack may not
+// get to finish. Where the piece is before each action goes in states.
+bool replayPath(const Game& game, const std::vector<Action>& path,
+	const Placement& placement, std::vector<Placement>* states)
+{
+	if (states != nullptr)
+		states->clear();
+
+	Game replay {game};
+	for (std::size_t i = 0; i <= path.size(); i++)
+	{
+		const Action action = (i < path.size()) ? path[i] : Action::HardDrop;
+		const Tetromino& t = replay.getPiece();
+		if (states != nullptr)
+			states->push_back(Placement{t.x, t.y, t.rot});
+
+		replay.input(action);
+		const Placement moved {t.x, t.y, t.rot};
+		const int tnum = t.tnum;
+		if (replay.tick().pieceLocked)
+			return coversSameCells(tnum, moved, placement);
+	}
+	return false;
+}
+
+
+Bot::Bot(const BotConfig& config, ThreadPool* pool)
+	: config{config}, pool{pool}
+{
+}
+
+
+Action Bot::chooseAction(const Game& game, const Clock::time_point deadline)
+{
+	if (game.isOver() || game.isClearingLines())
+		return Action::None;
+
+	const Tetromino& t = game.getPiece();
+	const bool isOnPath = (pathIndex < pathStates.size()) &&
+		t.x == pathStates[pathIndex].x &&
+		t.y == pathStates[pathIndex].y &&
+		t.rot == pathStates[pathIndex].rot;
+
+	if (!hasTarget || plannedPiece != game.getPiecesPlaced())
+	{
+		plannedPiece = game.getPiecesPlaced();
+		chooseTarget(game, deadline);
+	}
+	else if (!isOnPath)
+	{
+		// Frames went by without an action from the bot,
+		// so find the way again from here
+		if (!findPathToTarget(game))
+			chooseTarget(game, deadline);
+	}
+	if (!hasTarget)
+		return Action::SoftDrop;
+
+	// Once above the target, drop the piece straight onto it
+	const Action action = (pathIndex < path.size()) ? path[pathIndex] : Action::HardDrop;
+	pathIndex++;
+	return action;
+}
+
+
+void Bot::chooseTarget(const Game& game, const Clock::time_point deadline)
+{
+	// Beam search: place the current piece in every reachable way, keep
+	// the best few resulting fields, place the next piece from the bag
+	// on each of those, and so on. The target is the placement of the
+	// current piece that led to the best field at the deepest step.
+	const Field& field = game.getField();
+	const Tetromino& t = game.getPiece();
+	const PieceGenerator& preview = game.getPieceGenerator();
+	const int depth = std::max(1, std::min(config.depth, preview.getPreviewSize() + 1));
+	const std::size_t numWorkers = (pool != nullptr) ? pool->size() : 1;
+
+	// The root step is a single search, so split its placements instead
+	hasTarget = false;
+	const SearchNode root {field, 0, 0.0, -1};
+	const std::vector<Placement>& rootPlacements = finder.find(field, t);
+	const std::size_t numRootTasks = std::max<std::size_t>(1,
+		std::min(numWorkers, rootPlacements.size()));
+	buckets.resize(std::max(buckets.size(), numRootTasks));
+	rootPaths.resize(rootPlacements.size());
+	rootReachable.assign(rootPlacements.size(), 0);
+	std::atomic<bool> rootOutOfTime {false};
+	runTasks(numRootTasks, [&](const std::size_t i) {
+		const std::size_t begin = rootPlacements.size() * i / numRootTasks;
+		const std::size_t end = rootPlacements.size() * (i + 1) / numRootTasks;
+		buckets[i].clear();
+		for (std::size_t j = begin; j < end; j++)
+		{
+			if (rootOutOfTime || Clock::now() >= deadline)
+			{
+				rootOutOfTime = true;
+				return;
+			}
+			if (!findReachablePath(game, j, rootPaths[j]))
+				continue;
+			rootReachable[j] = 1;
+			addChildren(root, t, rootPlacements, j, j + 1, buckets[i]);
+		}
+	});
+	if (rootOutOfTime)
+	{
+		startFirstReachable(game);
+		return;
+	}
+	children.clear();
+	for (std::size_t i = 0; i < numRootTasks; i++)
+		children.insert(children.end(), buckets[i].begin(), buckets[i].end());
+	keepBestChildren();
+	if (beam.empty())
+		return;
+
+	// The best root so far, from the last step that was searched in full
+	int bestRoot = beam.front().rootIndex;
+	for (int step = 1; step < depth; step++)
+	{
+		// One task per beam node, each placing the next piece in every
+		// column and rotation it can drop straight down from
+		const Tetromino next {preview.peek(step - 1)};
+		std::atomic<bool> outOfTime {false};
+		buckets.resize(std::max(buckets.size(), beam.size()));
+		runTasks(beam.size(), [&](const std::size_t i) {
+			buckets[i].clear();
+			if (outOfTime || Clock::now() >= deadline)
+			{
+				outOfTime = true;
+				return;
+			}
+			thread_local std::vector<Placement> placements;
+			findDropPlacements(beam[i].field, next, placements);
+			addChildren(beam[i], next, placements, 0, placements.size(), buckets[i]);
+		});
+		if (outOfTime)
+			break;
+
+		children.clear();
+		for (std::size_t i = 0; i < beam.size(); i++)
+			children.insert(children.end(), buckets[i].begin(), buckets[i].end());
+		if (children.empty())
+			break;
+
+		keepBestChildren();
+		bestRoot = beam.front().rootIndex;
+	}
+
+	hasTarget = true;
+	target = finder.getPlacements()[bestRoot];
+	startPath(game, std::move(rootPaths[bestRoot]));
+}
+
+
+void Bot::startFirstReachable(const Game& game)
+{
+	// Take the first placement already found reachable, and only
+	// look for one if none was. Locking too high ends the game.
+	const std::vector<Placement>& placements = finder.getPlacements();
+	std::size_t first = 0;
+	while (first < placements.size() &&
+		(!rootReachable[first] || placements[first].y <= 1))
+	{
+		first++;
+	}
+	if (first == placements.size())
+	{
+		first = 0;
+		while (first < placements.size() &&
+			(placements[first].y <= 1 || !findReachablePath(game, first, rootPaths[first])))
+		{
+			first++;
+		}
+		if (first == placements.size())
+			return;
+	}
+
+	hasTarget = true;
+	target = placements[first];
+	startPath(game, std::move(rootPaths[first]));
+}
+
+
+void Bot::runTasks(const std::size_t numTasks,
+	const std::function<void(std::size_t)>& task)
+{
+	if (pool == nullptr || numTasks <= 1)
+	{
+		for (std::size_t i = 0; i < numTasks; i++)
+			task(i);
+		return;
+	}
+
+	TaskGroup group;
+	for (std::size_t i = 0; i < numTasks; i++)
+		pool->submit([&task, i] { task(i); }, &group);
+	pool->wait(group);
+}
+
+
+void Bot::addChildren(const SearchNode& node, const Tetromino& start,
+	const std::vector<Placement>& placements,
+	const std::size_t begin, const std::size_t end,
+	std::vector<SearchNode>& out)
+{
+	const bool isRoot = (node.rootIndex < 0);
+	Tetromino placed {start};
+	for (std::size_t i = begin; i < end; i++)
+	{
+		// Locking this high ends the game
+		const Placement& placement = placements[i];
+		if (placement.y <= 1)
+			continue;
+
+		placed.x = placement.x;
+		placed.y = placement.y;
+		placed.rot = placement.rot;
+		SearchNode child {node.field, node.numLinesCleared, 0.0, node.rootIndex};
+		child.numLinesCleared += placePieceAndClearLines(child.field, placed);
+
+		child.score = evaluateField(child.field, child.numLinesCleared);
+		if (isRoot)
+			child.rootIndex = static_cast<int>(i);
+		out.push_back(child);
+	}
+}
+
+
+void Bot::keepBestChildren()
+{
+	// Ties go to the child found first, so the result never depends
+	// on the sort implementation
+	const auto isBetter = [](const SearchNode& a, const SearchNode& b) {
+		return a.score > b.score;
+	};
+	std::stable_sort(children.begin(), children.end(), isBetter);
+
+	// Every node of a step places the same piece, so children with the
+	// same field hash are the same state. Only the first one found of
+	// the best scoring takes a place in the beam.
+	beam.clear();
+	for (const SearchNode& child : children)
+	{
+		if (static_cast<int>(beam.size()) == config.beamWidth)
+			break;
+		const std::uint64_t hash = child.field.getHash();
+		const bool isRepeat = std::any_of(beam.begin(), beam.end(),
+			[hash](const SearchNode& kept) { return kept.field.getHash() == hash; });
+		if (!isRepeat)
+			beam.push_back(child);
+	}
+}
+
+
+bool Bot::findPathToTarget(const Game& game)
+{
+	// The search may reach the same cells in another rotation than before
+	const Tetromino& t = game.getPiece();
+	const std::vector<Placement>& placements = finder.find(game.getField(), t);
+	std::vector<Action> newPath;
+	for (std::size_t i = 0; i < placements.size(); i++)
+	{
+		if (!coversSameCells(t.tnum, placements[i], target))
+			continue;
+		if (!findReachablePath(game, i, newPath))
+			return false;
+		startPath(game, std::move(newPath));
+		return true;
+	}
+	return false;
+}
+
+
+bool Bot::findReachablePath(const Game& game, const std::size_t i,
+	std::vector<Action>& reachablePath) const
+{
+	// Turning and sliding at the top leaves the most time before gravity
+	// lands the piece, but tucks under overhangs need the finder's path
+	const Placement& placement = finder.getPlacements()[i];
+	reachablePath = getDirectPath(game.getField(), game.getPiece(), placement);
+	if (replayPath(game, reachablePath, placement, nullptr))
+		return true;
+
+	reachablePath = finder.getPath(i);
+	trimTrailingDrops(reachablePath);
+	if (replayPath(game, reachablePath, placement, nullptr))
+		return true;
+
+	reachablePath.clear();
+	return false;
+}
+
+
+void Bot::startPath(const Game& game, std::vector<Action> newPath)
+{
+	path = std::move(newPath);
+	pathIndex = 0;
+	replayPath(game, path, target, &pathStates);
+}
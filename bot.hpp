@@ -0,0 +1,103 @@
+#ifndef BOT_HPP
+#define BOT_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include "field.hpp"
+#include "tetromino.hpp"
+#include "game.hpp"
+#include "placement.hpp"
+#include "thread_pool.hpp"
+
+// Weighted sum of field features; higher is better
+double evaluateField(const Field& field, const int numLinesCleared);
+
+struct BotConfig {
+	// Field states kept after each search step
+	int beamWidth {16};
+	// Pieces searched ahead, counting the current one. The search never
+	// looks past the end of the current bag, since later pieces are unknown.
+	int depth {3};
+};
+
+// Plays the game through the same actions a player would press.
+// For every new piece it picks the best placement it can find before
+// a deadline, then walks the piece there one action per frame.
+// Paths are played out first on a copy of the game, so placements that
+// gravity would not leave time to reach are never chosen.
+// Given a thread pool, each search step is spread across its workers;
+// the chosen placement is the same as without one.
+class Bot {
+public:
+	using Clock = std::chrono::steady_clock;
+
+	explicit Bot(const BotConfig& config = BotConfig{}, ThreadPool* pool = nullptr);
+
+	// The action to press this frame. Any search for a new target
+	// stops at the deadline with the best placement found so far.
+	Action chooseAction(const Game& game, const Clock::time_point deadline);
+
+private:
+	// A field state reached by placing some pieces from the root
+	struct SearchNode {
+		Field field;
+		int numLinesCleared;
+		double score;
+		// Which placement of the current piece this state started from
+		int rootIndex;
+	};
+
+	void chooseTarget(const Game& game, const Clock::time_point deadline);
+	// When the deadline passes before the placements of the current piece
+	// have all been checked, aim for the first one that can be reached
+	void startFirstReachable(const Game& game);
+	// Run task(0) to task(numTasks - 1), on the pool if there is one
+	void runTasks(std::size_t numTasks, const std::function<void(std::size_t)>& task);
+	// Place the piece at placements[begin, end) on top of the node's field
+	void addChildren(const SearchNode& node, const Tetromino& start,
+		const std::vector<Placement>& placements,
+		std::size_t begin, std::size_t end,
+		std::vector<SearchNode>& out);
+	// Keep the best children with distinct fields, up to the beam width
+	void keepBestChildren();
+	bool findPathToTarget(const Game& game);
+	// Find the first of the direct path and the finder's path i that
+	// gets the piece to placement i in time. False if neither does.
+	bool findReachablePath(const Game& game, std::size_t i,
+		std::vector<Action>& reachablePath) const;
+	void startPath(const Game& game, std::vector<Action> newPath);
+
+	BotConfig config;
+	ThreadPool* pool;
+
+	// Searches the current piece's placements and keeps them for getPath()
+	PlacementFinder finder;
+
+	// Beam search buffers, kept between searches. Each task fills its own
+	// bucket, and the buckets are joined in order so that ties between
+	// equal scores break the same way however the tasks were scheduled.
+	std::vector<SearchNode> beam;
+	std::vector<SearchNode> children;
+	std::vector<std::vector<SearchNode>> buckets;
+	// How to reach each placement of the current piece, and whether the
+	// search got as far as finding that it can be reached. One char per
+	// placement, so that tasks can set their own without a data race.
+	std::vector<std::vector<Action>> rootPaths;
+	std::vector<char> rootReachable;
+
+	// The piece the current plan is for, counted by Game::getPiecesPlaced()
+	unsigned int plannedPiece {0};
+	bool hasTarget {false};
+	Placement target {};
+
+	// Actions to press, followed by a hard drop
+	std::vector<Action> path;
+	std::size_t pathIndex {0};
+	// Where the piece should be before each action if the path is followed
+	std::vector<Placement> pathStates;
+};
+
+#endif // BOT_HPP
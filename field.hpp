@@ -0,0 +1,252 @@
+#ifndef FIELD_HPP
+#define FIELD_HPP
+
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <type_traits>
+
+// One bit per column, bit x set when column x of the row is occupied.
+// The walls are stored as occupied cells so that collision tests
+// need no separate bounds checks on x. The narrowest integer that
+// holds a row is picked at compile time from the board width.
+template <int W>
+using BasicFieldRow = std::conditional_t<(W <= 16), std::uint16_t, std::uint64_t>;
+
+// Zobrist hashing by rows: every row of the board gets a fixed random
+// key, and a field's hash is the XOR over its rows of the cells inside
+// the walls mixed with the row's key. Changing or moving a row XORs its
+// old value out and its new one in, in constant time whatever the width,
+// so the hash is kept up to date as the field changes.
+constexpr std::uint64_t splitMix64(std::uint64_t& state)
+{
+	std::uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+	return z ^ (z >> 31);
+}
+
+template <int N>
+constexpr std::array<std::uint64_t, N> makeZobristKeys()
+{
+	std::array<std::uint64_t, N> keys {};
+	std::uint64_t state {0x5eed};
+	for (int i = 0; i < N; i++)
+		keys[i] = splitMix64(state);
+	return keys;
+}
+
+// Number of cells set in a row, walls included
+template <typename Row>
+constexpr int countCells(Row cells)
+{
+	int count {0};
+	for (; cells != 0; count++)
+		cells &= static_cast<Row>(cells - 1);
+	return count;
+}
+
+// Summary of the stack of locked cells, kept up to date by the field
+// as pieces lock and lines are removed, so nothing has to rescan it
+template <int W, int H>
+struct BasicStackProfile {
+	// Height of each column's highest filled cell above the floor,
+	// 0 for an empty column. The walls count as full height.
+	std::array<std::uint8_t, W> columnHeights;
+	// Filled cells in each row inside the walls
+	std::array<std::uint8_t, H> rowCounts;
+	// Empty cells with a filled cell somewhere above them
+	int holes;
+};
+
+// A board W cells wide and H cells high, counting the walls and floor
+template <int W, int H>
+struct BasicField {
+	static_assert(W >= 3 && W <= 64, "Rows are at most 64 bits wide");
+	static_assert(H >= 3 && H <= 255, "Column heights are stored in a byte");
+
+	static constexpr int WIDTH {W};
+	static constexpr int HEIGHT {H};
+	static constexpr int LENGTH {W * H};
+
+	using Row = BasicFieldRow<W>;
+	using Profile = BasicStackProfile<W, H>;
+
+	static constexpr Row FULL_ROW = (W == 64) ? static_cast<Row>(~Row{0}) :
+		static_cast<Row>((Row{1} << (W % 64)) - 1);
+	static constexpr Row WALL_ROW = static_cast<Row>(Row{1} | (Row{1} << (W - 1)));
+
+	static constexpr std::array<std::uint64_t, H> zobristKeys = makeZobristKeys<H>();
+
+	// What row y adds to the hash when its cells are "cells".
+	// An empty row adds nothing.
+	static constexpr std::uint64_t getRowHash(int y, Row cells)
+	{
+		const auto inside = static_cast<std::uint64_t>(cells & ~WALL_ROW);
+		if (inside == 0)
+			return 0;
+		std::uint64_t state = zobristKeys[y] ^ inside;
+		return splitMix64(state);
+	}
+
+	// Occupancy plane, used by all collision and line checks
+	std::array<Row, H> rows;
+	// Glyph plane, only used for drawing
+	std::array<char, LENGTH> glyphs;
+
+	BasicField()
+	{
+		for (int y = 0; y < H; y++)
+		{
+			const bool isFloor = (y == H - 1);
+			rows[y] = isFloor ? FULL_ROW : WALL_ROW;
+			profile.rowCounts[y] = isFloor ? W - 2 : 0;
+			const int fieldRow = y * W;
+			for (int x = 0; x < W; x++)
+			{
+				const int i = fieldRow + x;
+				if (x == 0 || x == W - 1 || isFloor)
+					glyphs[i] = '#';
+				else
+					glyphs[i] = ' ';
+			}
+		}
+
+		profile.columnHeights.fill(0);
+		profile.columnHeights.front() = H - 1;
+		profile.columnHeights.back() = H - 1;
+		profile.holes = 0;
+	}
+
+	const Profile& getProfile() const
+	{
+		return profile;
+	}
+
+	// Zobrist hash of the occupancy plane; 0 for an empty field
+	std::uint64_t getHash() const
+	{
+		return hash;
+	}
+
+	bool isOccupied(int x, int y) const
+	{
+		assert(x >= 0 && x < W && y >= 0 && y < H);
+		return (rows[y] >> x) & 1;
+	}
+
+	bool lineIsFull(int y) const
+	{
+		assert(y >= 0 && y < H);
+		return profile.rowCounts[y] == W - 2;
+	}
+
+	// Replace the occupancy of row y, keeping the hash and row count
+	// up to date. The glyphs are left for the caller, and the columns
+	// for removeLineFromColumns().
+	void setRow(int y, Row cells)
+	{
+		assert(y >= 0 && y < H - 1 && (cells & WALL_ROW) == WALL_ROW);
+		hash ^= getRowHash(y, rows[y]) ^ getRowHash(y, cells);
+		rows[y] = cells;
+		profile.rowCounts[y] = static_cast<std::uint8_t>(countCells<Row>(cells & ~WALL_ROW));
+	}
+
+	// Move the occupancy of row fromY down to row toY, keeping the hash
+	// and row count up to date without looking at the cells. Row fromY
+	// keeps its cells until it is overwritten in turn. The glyphs are
+	// left for the caller, and the columns for removeLineFromColumns().
+	void moveRow(int fromY, int toY)
+	{
+		assert(fromY >= 0 && fromY < toY && toY < H - 1);
+		hash ^= getRowHash(toY, rows[toY]) ^ getRowHash(toY, rows[fromY]);
+		rows[toY] = rows[fromY];
+		profile.rowCounts[toY] = profile.rowCounts[fromY];
+	}
+
+	// Update the column heights and holes for full line y being removed.
+	// When removing several lines, call this for each from the top down,
+	// before any rows have been moved.
+	void removeLineFromColumns(int y)
+	{
+		assert(y >= 0 && y < H - 1 && lineIsFull(y));
+		const int lineHeight = H - 1 - y;
+		for (int x = 1; x < W - 1; x++)
+		{
+			std::uint8_t& height = profile.columnHeights[x];
+			if (height > lineHeight)
+			{
+				height--;
+				continue;
+			}
+
+			// The line held the column's top cell, so the empty cells
+			// down to the next filled one are no longer covered.
+			// The floor is full, so the scan always stops.
+			int below = y + 1;
+			while (((rows[below] >> x) & 1) == 0)
+				below++;
+			const int newHeight = H - 1 - below;
+			profile.holes -= lineHeight - 1 - newHeight;
+			height = static_cast<std::uint8_t>(newHeight);
+		}
+	}
+
+	// Mark every cell whose bit is set in "cells" as occupied by "glyph"
+	void fillCells(int y, Row cells, char glyph)
+	{
+		assert(y >= 0 && y < H - 1 && (cells & ~FULL_ROW) == 0);
+		const auto newCells = static_cast<Row>(cells & ~rows[y] & ~WALL_ROW);
+		hash ^= getRowHash(y, rows[y]) ^ getRowHash(y, rows[y] | cells);
+		rows[y] |= cells;
+
+		const int cellHeight = H - 1 - y;
+		for (int x = 1; x < W - 1; x++)
+		{
+			if (((newCells >> x) & 1) == 0)
+				continue;
+			profile.rowCounts[y]++;
+			std::uint8_t& height = profile.columnHeights[x];
+			if (cellHeight > height)
+			{
+				// Every empty cell between the old top and this one is covered
+				profile.holes += cellHeight - height - 1;
+				height = static_cast<std::uint8_t>(cellHeight);
+			}
+			else
+			{
+				profile.holes--;
+			}
+		}
+
+		const int fieldRow = y * W;
+		for (int x = 0; x < W; x++)
+		{
+			if ((cells >> x) & 1)
+				glyphs[fieldRow + x] = glyph;
+		}
+	}
+
+private:
+	Profile profile;
+	std::uint64_t hash {0};
+};
+
+// The standard board: 10 columns inside the walls, 17 rows above the floor
+using Field = BasicField<12, 18>;
+using FieldRow = Field::Row;
+using StackProfile = Field::Profile;
+
+constexpr int FIELD_WIDTH {Field::WIDTH};
+constexpr int FIELD_HEIGHT {Field::HEIGHT};
+constexpr int FIELD_LENGTH {Field::LENGTH};
+constexpr FieldRow FULL_ROW {Field::FULL_ROW};
+constexpr FieldRow WALL_ROW {Field::WALL_ROW};
+
+// A board for stress tests, wide enough to need 64-bit rows
+using WideField = BasicField<42, 24>;
+
+static_assert(std::is_same_v<FieldRow, std::uint16_t>, "Standard rows should be 16 bits");
+static_assert(std::is_same_v<WideField::Row, std::uint64_t>, "Wide rows should be 64 bits");
+
+#endif // FIELD_HPP
@@ -0,0 +1,101 @@
+#ifndef FRAME_SCHEDULER_HPP
+#define FRAME_SCHEDULER_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <poll.h>
+
+// Paces the main loop at exactly 60 frames per second on average.
+// Every frame has an absolute deadline on the monotonic clock, computed
+// from the start time rather than from the previous frame, so neither
+// wall clock changes nor oversleeping can make the frame rate drift.
+class FrameScheduler {
+public:
+	using Clock = std::chrono::steady_clock;
+
+	static constexpr std::int64_t FRAMES_PER_SECOND {60};
+	// Longest stall that is made up for with extra frames.
+	// Anything longer (e.g. a suspended process) is skipped.
+	static constexpr int MAX_CATCH_UP_FRAMES {8};
+
+	FrameScheduler()
+		: start{Clock::now()}
+	{
+	}
+
+	// Sleep until the next frame is due and return how many frames
+	// are due: 1 normally, more if deadlines were missed and the
+	// game has to catch up to stay in time
+	int waitForNextFrame()
+	{
+		frameNum++;
+		const Clock::time_point deadline = getDeadline(frameNum);
+		const Clock::time_point now = Clock::now();
+		if (now < deadline)
+		{
+			std::this_thread::sleep_until(deadline);
+			return 1;
+		}
+
+		// Every frame whose deadline has already passed is due now
+		const std::int64_t lateFrames = (now - deadline) / getFramePeriod();
+		if (lateFrames >= MAX_CATCH_UP_FRAMES)
+		{
+			// Too far behind: start counting again from now.
+			// Every deadline that passed still counts as missed.
+			missedDeadlines += lateFrames + 1;
+			start = now;
+			frameNum = 0;
+			return MAX_CATCH_UP_FRAMES;
+		}
+		frameNum += lateFrames;
+		missedDeadlines += lateFrames + 1;
+		return static_cast<int>(lateFrames) + 1;
+	}
+
+	// Block until fd has input to read or the next frame is due,
+	// whichever comes first. Returns true if there is input.
+	// poll() only counts whole milliseconds, so the last fraction of
+	// a millisecond before the deadline is left to waitForNextFrame().
+	bool waitForInput(int fd) const
+	{
+		const auto timeLeft = getNextDeadline() - Clock::now();
+		const auto msLeft = std::chrono::duration_cast<std::chrono::milliseconds>(timeLeft).count();
+		if (msLeft <= 0)
+			return false;
+
+		pollfd pfd {fd, POLLIN, 0};
+		return poll(&pfd, 1, static_cast<int>(msLeft)) > 0;
+	}
+
+	// When the frame after the current one is due
+	Clock::time_point getNextDeadline() const
+	{
+		return getDeadline(frameNum + 1);
+	}
+
+	std::uint64_t getMissedDeadlines() const
+	{
+		return missedDeadlines;
+	}
+
+private:
+	static constexpr std::chrono::nanoseconds getFramePeriod()
+	{
+		return std::chrono::nanoseconds(std::chrono::seconds(1)) / FRAMES_PER_SECOND;
+	}
+
+	Clock::time_point getDeadline(std::int64_t frame) const
+	{
+		// Multiply before dividing so the 1/60 s period never rounds
+		const auto sinceStart = std::chrono::nanoseconds(std::chrono::seconds(1)) * frame / FRAMES_PER_SECOND;
+		return start + std::chrono::duration_cast<Clock::duration>(sinceStart);
+	}
+
+	Clock::time_point start;
+	std::int64_t frameNum {0};
+	std::uint64_t missedDeadlines {0};
+};
+
+#endif // FRAME_SCHEDULER_HPP
@@ -0,0 +1,406 @@
+#include "game.hpp"
+#include <algorithm>
+#include <cassert>
+
+
+template <int W, int H>
+BasicGame<W, H>::BasicGame(std::uint64_t seed, int lineClearFrames)
+	: state{seed, lineClearFrames, SPAWN_X}
+{
+}
+
+
+template <int W, int H>
+void BasicGame<W, H>::input(Action action)
+{
+	if (state.gameOver)
+		return;
+
+	if (isClearingLines())
+	{
+		state.bufferedInputs.push(action);
+		return;
+	}
+
+	// A hard dropped piece has landed and only waits for tick() to lock it
+	if (state.hardDropped)
+		return;
+
+	int newRotation {state.t.rot};
+	switch (action)
+	{
+	case Action::Left:
+		state.t.x--;
+		if (!pieceCanFit(state.field, state.t))
+			state.t.x++;
+		break;
+	case Action::Right:
+		state.t.x++;
+		if (!pieceCanFit(state.field, state.t))
+			state.t.x--;
+		break;
+	case Action::SoftDrop:
+		state.softDropRequested = true;
+		break;
+	case Action::HardDrop:
+		state.t.y = getLandingRow(state.field, state.t);
+		state.hardDropped = true;
+		break;
+	case Action::RotateCCW:
+		// Rotate 90 degrees counterclockwise
+		newRotation = (newRotation == 0) ? 3 : newRotation - 1;
+		break;
+	case Action::RotateCW:
+		// Rotate 90 degrees clockwise
+		newRotation = (newRotation == 3) ? 0 : newRotation + 1;
+		break;
+	default:
+		break;
+	}
+
+	if (newRotation != state.t.rot)
+		tryRotate(state.field, state.t, newRotation);
+}
+
+
+template <int W, int H>
+StepResult BasicGame<W, H>::tick()
+{
+	StepResult result;
+	if (state.gameOver)
+		return result;
+
+	state.frame++;
+	if (isClearingLines())
+	{
+		// Gravity is paused while the full lines are shown
+		state.clearFramesLeft--;
+		if (!isClearingLines())
+			finishLineClear(result);
+		return result;
+	}
+
+	const bool shouldForceDownward = state.hardDropped || state.softDropRequested ||
+		(state.numTicks >= state.maxTicksPerLine);
+	state.softDropRequested = false;
+
+	if (shouldForceDownward)
+	{
+		if (state.hardDropped)
+		{
+			// The piece already rests on the stack
+			state.hardDropped = false;
+			lockPiece(result);
+		}
+		else
+		{
+			state.t.y++;
+			if (!pieceCanFit(state.field, state.t))
+			{
+				state.t.y--;
+				lockPiece(result);
+			}
+		}
+		state.numTicks = 0;
+	}
+
+	state.numTicks++;
+	return result;
+}
+
+
+template <int W, int H>
+StepResult BasicGame<W, H>::step(const Inputs& inputs)
+{
+	for (int i = 0; i < inputs.count; i++)
+		input(inputs.actions[i]);
+	return tick();
+}
+
+
+template <int W, int H>
+void BasicGame<W, H>::lockPiece(StepResult& result)
+{
+	result.pieceLocked = true;
+	if (state.t.y <= 1)
+	{
+		state.gameOver = true;
+		return;
+	}
+
+	addPieceToField(state.field, state.t);
+	state.piecesPlaced++;
+
+	// Check if any lines should be cleared
+	const PieceMask& mask = state.t.getMask();
+	for (int y = mask.top; y <= mask.bottom; y++)
+	{
+		const int screenRow = state.t.y + y;
+		// Stop if going outside the boundaries
+		if (screenRow >= H - 1)
+			break;
+
+		if (state.field.lineIsFull(screenRow))
+		{
+			// Rewrite all the characters with '='
+			const auto row = state.field.glyphs.begin() + (screenRow * W);
+			std::fill(row + 1, row + W - 1, '=');
+
+			// Save the location of this line so it can be cleared later
+			state.lowestLineToClear = screenRow;
+			state.numLinesToClear++;
+		}
+	}
+	result.numLinesToClear = state.numLinesToClear;
+
+	spawnNextPiece();
+
+	if (state.numLinesToClear > 0)
+	{
+		state.clearFramesLeft = state.lineClearFrames;
+		if (!isClearingLines())
+			finishLineClear(result);
+	}
+}
+
+
+template <int W, int H>
+void BasicGame<W, H>::spawnNextPiece()
+{
+	state.t.reset(state.pieceGenerator.next());
+	state.t.x = SPAWN_X;
+}
+
+
+template <int W, int H>
+void BasicGame<W, H>::finishLineClear(StepResult& result)
+{
+	// Keep track of player progress
+	state.totalNumLinesCleared += state.numLinesToClear;
+
+	// Scoring system similar to original Nintendo system
+	const int scoringLevel = state.level + 1;
+	switch (state.numLinesToClear)
+	{
+	case 1:
+		state.score += 40 * scoringLevel;
+		break;
+	case 2:
+		state.score += 100 * scoringLevel;
+		break;
+	case 3:
+		state.score += 300 * scoringLevel;
+		break;
+	case 4:
+		state.score += 1200 * scoringLevel;
+		break;
+	}
+
+	// Check if level should advance
+	state.tenLineCounter += state.numLinesToClear;
+	if (state.tenLineCounter >= 10)
+	{
+		state.level++;
+		state.tenLineCounter -= 10;
+
+		// Adjust timing
+		if (state.level < 8 && state.maxTicksPerLine > 5)
+			state.maxTicksPerLine -= 5;
+		else if (state.maxTicksPerLine > 1)
+			state.maxTicksPerLine--;
+	}
+
+	clearLinesFromField(state.field, state.lowestLineToClear);
+	result.numLinesCleared = state.numLinesToClear;
+	state.numLinesToClear = 0;
+	state.lowestLineToClear = 0;
+
+	// Replay whatever was pressed during the animation
+	const Inputs pending = state.bufferedInputs;
+	state.bufferedInputs = Inputs{};
+	for (int i = 0; i < pending.count; i++)
+		input(pending.actions[i]);
+}
+
+
+template <int W, int H>
+void clearLinesFromField(BasicField<W, H>& field, int lowestLineToClear)
+{
+	assert(lowestLineToClear >= 0 && lowestLineToClear < H - 1);
+
+	// The column summary is updated from the rows as they are now
+	for (int y = 0; y <= lowestLineToClear; y++)
+	{
+		if (field.lineIsFull(y))
+			field.removeLineFromColumns(y);
+	}
+
+	// Walk up from the lowest full line, moving every other row down
+	// past the full lines found below it. Each row moves once, as a
+	// whole, and only rows that were already read are overwritten.
+	int writeY {lowestLineToClear};
+	for (int readY = lowestLineToClear; readY >= 0; readY--)
+	{
+		if (field.lineIsFull(readY))
+			continue;
+
+		if (writeY != readY)
+		{
+			field.moveRow(readY, writeY);
+			const auto oldRow = field.glyphs.begin() + (readY * W);
+			const auto newRow = field.glyphs.begin() + (writeY * W);
+			std::copy(oldRow + 1, oldRow + W - 1, newRow + 1);
+		}
+		writeY--;
+	}
+
+	// What is left at the top was emptied by the lines that went away
+	for (; writeY >= 0; writeY--)
+	{
+		field.setRow(writeY, BasicField<W, H>::WALL_ROW);
+		const auto newRow = field.glyphs.begin() + (writeY * W);
+		std::fill(newRow + 1, newRow + W - 1, ' ');
+	}
+}
+
+
+template <int W, int H>
+bool pieceCanFit(const BasicField<W, H>& field, const Tetromino& t)
+{
+	using Row = typename BasicField<W, H>::Row;
+	const PieceMask& mask = t.getMask();
+	const int shift = t.x + mask.left;
+	if (shift < 0 ||
+		t.x + mask.right >= W ||
+		t.y + mask.top < 0 ||
+		t.y + mask.bottom >= H)
+	{
+		return false;
+	}
+
+	// Every row the piece covers is inside the field from here on
+	for (int y = mask.top; y <= mask.bottom; y++)
+	{
+		const auto cells = static_cast<Row>(Row{mask.rows[y]} << shift);
+		if (field.rows[t.y + y] & cells)
+			return false;
+	}
+	return true;
+}
+
+
+template <int W, int H>
+void addPieceToField(BasicField<W, H>& field, const Tetromino& t)
+{
+	assert(pieceCanFit(field, t));
+	using Row = typename BasicField<W, H>::Row;
+	const PieceMask& mask = t.getMask();
+	const int shift = t.x + mask.left;
+	for (int y = mask.top; y <= mask.bottom; y++)
+	{
+		const auto cells = static_cast<Row>(Row{mask.rows[y]} << shift);
+		field.fillCells(t.y + y, cells, mask.glyph);
+	}
+}
+
+
+template <int W, int H>
+int placePieceAndClearLines(BasicField<W, H>& field, const Tetromino& t)
+{
+	addPieceToField(field, t);
+
+	int numLinesToClear {0};
+	int lowestLineToClear {0};
+	const PieceMask& mask = t.getMask();
+	for (int y = mask.top; y <= mask.bottom; y++)
+	{
+		const int screenRow = t.y + y;
+		if (screenRow < H - 1 && field.lineIsFull(screenRow))
+		{
+			lowestLineToClear = screenRow;
+			numLinesToClear++;
+		}
+	}
+
+	if (numLinesToClear > 0)
+		clearLinesFromField(field, lowestLineToClear);
+	return numLinesToClear;
+}
+
+
+template <int W, int H>
+int getLandingRow(const BasicField<W, H>& field, const Tetromino& t)
+{
+	// Each column of the piece can fall until its lowest cell
+	// rests on top of that column of the stack
+	const PieceMask& mask = t.getMask();
+	const auto& profile = field.getProfile();
+	int landingRow {H};
+	for (int x = 0; x <= mask.right - mask.left; x++)
+	{
+		const int column = t.x + mask.left + x;
+		const int topRow = H - 1 - profile.columnHeights[column];
+		landingRow = std::min(landingRow, topRow - 1 - mask.columnBottoms[x]);
+	}
+	if (landingRow >= t.y)
+		return landingRow;
+
+	// The piece is under an overhang, so the stack below it has gaps
+	// the heights cannot describe
+	Tetromino dropped {t};
+	do
+	{
+		dropped.y++;
+	}
+	while (pieceCanFit(field, dropped));
+	return dropped.y - 1;
+}
+
+
+template <int W, int H>
+bool tryRotate(const BasicField<W, H>& field, Tetromino& t, const int newRotation)
+{
+	const int startX = t.x;
+	const int startY = t.y;
+	const int startRotation = t.rot;
+
+	// Piece 0, the I, has its own kicks, and piece 3, the O,
+	// looks the same in every rotation, so it never kicks
+	const int direction = (newRotation == ((startRotation + 1) % 4)) ? 0 : 1;
+	const auto& kicks = (t.tnum == 0) ? iKicks[startRotation][direction] :
+		jlstzKicks[startRotation][direction];
+	const int numTests = (t.tnum == 3) ? 1 : NUM_KICK_TESTS;
+
+	t.rot = newRotation;
+	for (int i = 0; i < numTests; i++)
+	{
+		t.x = startX + kicks[i].dx;
+		t.y = startY - kicks[i].dy;
+		if (pieceCanFit(field, t))
+			return true;
+	}
+
+	t.x = startX;
+	t.y = startY;
+	t.rot = startRotation;
+	return false;
+}
+
+
+// The board sizes the engine is built for
+template class BasicGame<FIELD_WIDTH, FIELD_HEIGHT>;
+template class BasicGame<WideField::WIDTH, WideField::HEIGHT>;
+
+template void clearLinesFromField(Field&, int);
+template bool pieceCanFit(const Field&, const Tetromino&);
+template void addPieceToField(Field&, const Tetromino&);
+template int placePieceAndClearLines(Field&, const Tetromino&);
+template int getLandingRow(const Field&, const Tetromino&);
+template bool tryRotate(const Field&, Tetromino&, const int);
+
+template void clearLinesFromField(WideField&, int);
+template bool pieceCanFit(const WideField&, const Tetromino&);
+template void addPieceToField(WideField&, const Tetromino&);
+template int placePieceAndClearLines(WideField&, const Tetromino&);
+template int getLandingRow(const WideField&, const Tetromino&);
+template bool tryRotate(const WideField&, Tetromino&, const int);
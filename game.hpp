@@ -0,0 +1,199 @@
+#ifndef GAME_HPP
+#define GAME_HPP
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include "field.hpp"
+#include "tetromino.hpp"
+#include "piece_generator.hpp"
+
+// Everything a player can do to the falling piece
+enum class Action {
+	None,
+	Left,
+	Right,
+	SoftDrop,
+	RotateCCW,
+	RotateCW,
+	HardDrop
+};
+
+// The actions pressed during one frame, applied in order
+struct Inputs {
+	static constexpr int MAX_ACTIONS {8};
+	std::array<Action, MAX_ACTIONS> actions {};
+	int count {0};
+
+	Inputs() = default;
+
+	Inputs(Action action)
+	{
+		push(action);
+	}
+
+	void push(Action action)
+	{
+		if (action != Action::None && count < MAX_ACTIONS)
+			actions[count++] = action;
+	}
+};
+
+// What happened during a call to Game::step()
+struct StepResult {
+	bool pieceLocked {false};
+	// Full lines that were just marked with '=' and start the animation
+	int numLinesToClear {0};
+	// Lines removed from the field at the end of the animation
+	int numLinesCleared {0};
+};
+
+// Everything a game is made of, in one trivially copyable block of a few
+// hundred bytes, so that saving or rolling back a game is a plain memcpy.
+// BasicGame owns one and applies the rules to it.
+template <int W, int H>
+struct BasicGameState {
+	BasicField<W, H> field;
+	PieceGenerator pieceGenerator;
+	Tetromino t;
+
+	bool softDropRequested {false};
+	// The piece was hard dropped and locks on the next tick()
+	bool hardDropped {false};
+	bool gameOver {false};
+
+	unsigned int totalNumLinesCleared {0};
+	unsigned int score {0};
+	unsigned int level {0};
+	unsigned int tenLineCounter {0};
+	unsigned int piecesPlaced {0};
+
+	// Line clear animation
+	int lineClearFrames;
+	int clearFramesLeft {0};
+	int numLinesToClear {0};
+	int lowestLineToClear {0};
+	Inputs bufferedInputs;
+
+	// Timing
+	int numTicks {0};
+	int maxTicksPerLine {48};
+	// Frames run by tick() so far, up to the one that ended the game
+	unsigned int frame {0};
+
+	BasicGameState(std::uint64_t seed, int lineClearFrames, int spawnX)
+		: pieceGenerator{seed}, t{pieceGenerator.next()},
+		  lineClearFrames{lineClearFrames}
+	{
+		t.x = spawnX;
+	}
+};
+
+// The rules of the game, without any drawing, sleeping or clock reads.
+// One call to step() is one frame; the front end decides how fast
+// frames happen. The board is W by H cells counting the walls and floor,
+// fixed at compile time so each size gets its own row type and loops.
+template <int W, int H>
+class BasicGame {
+public:
+	using FieldType = BasicField<W, H>;
+	using State = BasicGameState<W, H>;
+	static_assert(H <= 127, "Tetromino keeps its row in a byte");
+	static_assert(std::is_trivially_copyable_v<State>,
+		"Snapshots are copied byte for byte");
+
+	// Pieces spawn centred, or just left of centre on odd widths
+	static constexpr int SPAWN_X {W / 2 - 2};
+
+	// 600 ms at 60 frames per second
+	static constexpr int DEFAULT_LINE_CLEAR_FRAMES {36};
+
+	// The same seed always deals the same sequence of pieces.
+	// Full lines stay on the field, marked with '=', for lineClearFrames
+	// frames before they are removed; headless players can pass 0.
+	explicit BasicGame(std::uint64_t seed,
+		int lineClearFrames = DEFAULT_LINE_CLEAR_FRAMES);
+
+	// Apply one action to the falling piece immediately.
+	// A soft drop is remembered and carried out by the next tick().
+	// A hard drop moves the piece straight down as far as it goes,
+	// and the next tick() locks it there; until then other actions
+	// are ignored.
+	// During the line clear animation actions are buffered instead,
+	// and applied once the lines are gone.
+	void input(Action action);
+
+	// Advance gravity or the line clear animation by one frame
+	StepResult tick();
+
+	StepResult step(const Inputs& inputs);
+
+	// Save the whole game, to be put back later with restore().
+	// Neither allocates; both copy sizeof(State) bytes.
+	State snapshot() const
+	{
+		return state;
+	}
+
+	void restore(const State& saved)
+	{
+		std::memcpy(&state, &saved, sizeof(State));
+	}
+
+	// True while full lines are shown before being removed.
+	// There is no falling piece to draw during that time.
+	bool isClearingLines() const { return state.clearFramesLeft > 0; }
+
+	const FieldType& getField() const { return state.field; }
+	const Tetromino& getPiece() const { return state.t; }
+	unsigned int getScore() const { return state.score; }
+	unsigned int getLines() const { return state.totalNumLinesCleared; }
+	unsigned int getLevel() const { return state.level; }
+	unsigned int getPiecesPlaced() const { return state.piecesPlaced; }
+	unsigned int getFrame() const { return state.frame; }
+	// Knows which pieces follow the current one in its bag
+	const PieceGenerator& getPieceGenerator() const { return state.pieceGenerator; }
+	bool isOver() const { return state.gameOver; }
+
+private:
+	void lockPiece(StepResult& result);
+	void spawnNextPiece();
+	void finishLineClear(StepResult& result);
+
+	State state;
+};
+
+// The standard game, and a wide board for stress tests.
+// These are the sizes game.cpp is compiled for.
+using Game = BasicGame<FIELD_WIDTH, FIELD_HEIGHT>;
+using WideGame = BasicGame<WideField::WIDTH, WideField::HEIGHT>;
+
+// Remove every full line at or above lowestLineToClear
+// and move the rows above them down
+template <int W, int H>
+void clearLinesFromField(BasicField<W, H>& field, int lowestLineToClear);
+
+template <int W, int H>
+bool pieceCanFit(const BasicField<W, H>& field, const Tetromino& t);
+
+// Copy the piece's cells into the field, without checking for full lines
+template <int W, int H>
+void addPieceToField(BasicField<W, H>& field, const Tetromino& t);
+
+// Add the piece to the field and remove any lines it completes,
+// returning how many were removed. This skips the line clear
+// animation, for searches that try out placements.
+template <int W, int H>
+int placePieceAndClearLines(BasicField<W, H>& field, const Tetromino& t);
+
+// The row the piece would lock at if it fell straight down from where it is
+template <int W, int H>
+int getLandingRow(const BasicField<W, H>& field, const Tetromino& t);
+
+// Turn the piece a quarter turn to newRotation, trying the SRS wall kicks
+// in order if it does not fit in place. Leaves it as is if none fit.
+template <int W, int H>
+bool tryRotate(const BasicField<W, H>& field, Tetromino& t, const int newRotation);
+
+#endif // GAME_HPP
@@ -0,0 +1,101 @@
+#ifndef PIECE_GENERATOR_HPP
+#define PIECE_GENERATOR_HPP
+
+#include <array>
+#include <cstdint>
+
+// PCG32 (XSH RR variant), from https://www.pcg-random.org
+// tetris.c implements the same generator, so both builds produce
+// the same piece sequence for the same seed.
+class Pcg32 {
+public:
+	static constexpr std::uint64_t DEFAULT_STREAM {0xda3e39cb94b95bdbULL};
+
+	explicit Pcg32(std::uint64_t seed, std::uint64_t stream = DEFAULT_STREAM)
+		: state{0}, inc{(stream << 1) | 1}
+	{
+		next();
+		state += seed;
+		next();
+	}
+
+	std::uint32_t next()
+	{
+		const std::uint64_t oldState = state;
+		state = oldState * 6364136223846793005ULL + inc;
+		const auto xorShifted = static_cast<std::uint32_t>(((oldState >> 18) ^ oldState) >> 27);
+		const auto rot = static_cast<std::uint32_t>(oldState >> 59);
+		return (xorShifted >> rot) | (xorShifted << ((32 - rot) & 31));
+	}
+
+	// Uniformly distributed in [0, bound), without modulo bias
+	std::uint32_t bounded(std::uint32_t bound)
+	{
+		const std::uint32_t threshold = (0u - bound) % bound;
+		while (true)
+		{
+			const std::uint32_t r = next();
+			if (r >= threshold)
+				return r % bound;
+		}
+	}
+
+private:
+	std::uint64_t state;
+	std::uint64_t inc;
+};
+
+// Deals tetrominoes in shuffled bags of all seven pieces
+class PieceGenerator {
+public:
+	static constexpr int BAG_SIZE {7};
+
+	explicit PieceGenerator(std::uint64_t seed)
+		: rng{seed}
+	{
+	}
+
+	int next()
+	{
+		if (currentBagIndex >= BAG_SIZE)
+		{
+			shuffleBag();
+			currentBagIndex = 0;
+		}
+		return pieceBag[currentBagIndex++];
+	}
+
+	// How many of the coming pieces are already known:
+	// the rest of the current bag
+	int getPreviewSize() const
+	{
+		return BAG_SIZE - currentBagIndex;
+	}
+
+	// The piece that next() will return after i more calls,
+	// for i < getPreviewSize()
+	int peek(int i) const
+	{
+		return pieceBag[currentBagIndex + i];
+	}
+
+private:
+	void shuffleBag()
+	{
+		// Fisher-Yates shuffle
+		for (int i = BAG_SIZE - 1; i >= 1; i--)
+		{
+			const int j = static_cast<int>(rng.bounded(i + 1));
+			const int temp = pieceBag[i];
+			pieceBag[i] = pieceBag[j];
+			pieceBag[j] = temp;
+		}
+	}
+
+	Pcg32 rng;
+	std::array<int, BAG_SIZE> pieceBag {{0, 1, 2, 3, 4, 5, 6}};
+	// Starts past the end so the first call shuffles
+	int currentBagIndex {BAG_SIZE};
+};
+
+#endif // PIECE_GENERATOR_HPP
@@ -0,0 +1,111 @@
+#include "placement.hpp"
+#include <algorithm>
+
+
+const std::vector<Placement>& PlacementFinder::find(const Field& field, const Tetromino& t)
+{
+	placements.clear();
+	placementStates.clear();
+	if (!pieceCanFit(field, t))
+		return placements;
+
+	stamp++;
+	if (stamp == 0)
+	{
+		// Stamps wrapped around, so old ones could look current
+		stateStamps.fill(0);
+		footprintStamps.fill(0);
+		stamp = 1;
+	}
+
+	// Moved around to test each neighbouring state
+	Tetromino probe {t};
+
+	int queueHead {0};
+	int queueTail {0};
+	const int start = getStateIndex(t.x, t.y, t.rot);
+	stateStamps[start] = stamp;
+	parents[start] = -1;
+	queue[queueTail++] = static_cast<std::int16_t>(start);
+
+	constexpr std::array<Action, 5> moves {{
+		Action::Left, Action::Right, Action::RotateCW, Action::RotateCCW, Action::SoftDrop
+	}};
+
+	while (queueHead < queueTail)
+	{
+		const int state = queue[queueHead++];
+		const int rot = state / (NUM_ROWS * NUM_COLS);
+		const int y = ((state / NUM_COLS) % NUM_ROWS) - Y_OFFSET;
+		const int x = (state % NUM_COLS) - X_OFFSET;
+
+		for (const Action move : moves)
+		{
+			probe.x = x;
+			probe.y = y;
+			probe.rot = rot;
+			bool moved {false};
+			switch (move)
+			{
+			case Action::Left:
+				probe.x--;
+				moved = pieceCanFit(field, probe);
+				break;
+			case Action::Right:
+				probe.x++;
+				moved = pieceCanFit(field, probe);
+				break;
+			case Action::RotateCW:
+				moved = tryRotate(field, probe, (rot == 3) ? 0 : rot + 1);
+				break;
+			case Action::RotateCCW:
+				moved = tryRotate(field, probe, (rot == 0) ? 3 : rot - 1);
+				break;
+			case Action::SoftDrop:
+				probe.y++;
+				moved = pieceCanFit(field, probe);
+				if (!moved)
+				{
+					// Resting here, so this state is a placement
+					// unless another state already covers the same cells
+					probe.y--;
+					const PieceMask& mask = probe.getMask();
+					const int shape = canonicalRotations[probe.tnum][rot];
+					const int footprint = (shape * FIELD_LENGTH) +
+						((y + mask.top) * FIELD_WIDTH) + x + mask.left;
+					if (footprintStamps[footprint] != stamp)
+					{
+						footprintStamps[footprint] = stamp;
+						placements.push_back(Placement{x, y, rot});
+						placementStates.push_back(state);
+					}
+				}
+				break;
+			default:
+				break;
+			}
+			if (!moved)
+				continue;
+
+			const int next = getStateIndex(probe.x, probe.y, probe.rot);
+			if (stateStamps[next] == stamp)
+				continue;
+			stateStamps[next] = stamp;
+			parents[next] = static_cast<std::int16_t>(state);
+			parentActions[next] = move;
+			queue[queueTail++] = static_cast<std::int16_t>(next);
+		}
+	}
+
+	return placements;
+}
+
+
+std::vector<Action> PlacementFinder::getPath(std::size_t i) const
+{
+	std::vector<Action> path;
+	for (int state = placementStates.at(i); parents[state] >= 0; state = parents[state])
+		path.push_back(parentActions[state]);
+	std::reverse(path.begin(), path.end());
+	return path;
+}
@@ -0,0 +1,63 @@
+#ifndef PLACEMENT_HPP
+#define PLACEMENT_HPP
+
+#include <array>
+#include <cstdint>
+#include <vector>
+#include "field.hpp"
+#include "tetromino.hpp"
+#include "game.hpp"
+
+// A position where a piece comes to rest and would lock
+struct Placement {
+	int x;
+	int y;
+	int rot;
+};
+
+// Finds every distinct resting place a piece can reach from where it is
+// through left, right, rotate and down moves, with a breadth-first search
+// over (x, y, rotation). Placements that cover the same cells, such as the
+// O piece in any rotation or I, S and Z turned 180 degrees, are listed once.
+// All buffers are kept between calls, so a finder should be reused.
+class PlacementFinder {
+public:
+	const std::vector<Placement>& find(const Field& field, const Tetromino& t);
+
+	const std::vector<Placement>& getPlacements() const
+	{
+		return placements;
+	}
+
+	// The shortest list of actions that takes the piece from its start
+	// to placement i of the last find()
+	std::vector<Action> getPath(std::size_t i) const;
+
+private:
+	// Room for pieces whose sprite box sticks out past the walls
+	static constexpr int X_OFFSET {2};
+	static constexpr int Y_OFFSET {2};
+	static constexpr int NUM_COLS {FIELD_WIDTH + X_OFFSET};
+	static constexpr int NUM_ROWS {FIELD_HEIGHT + Y_OFFSET};
+	static constexpr int NUM_STATES {4 * NUM_ROWS * NUM_COLS};
+
+	static int getStateIndex(const int x, const int y, const int rot)
+	{
+		return (((rot * NUM_ROWS) + y + Y_OFFSET) * NUM_COLS) + x + X_OFFSET;
+	}
+
+	// A state or footprint has been seen in this search
+	// when its stamp equals the current one
+	std::uint32_t stamp {0};
+	std::array<std::uint32_t, NUM_STATES> stateStamps {};
+	std::array<std::uint32_t, 4 * FIELD_LENGTH> footprintStamps {};
+
+	std::array<std::int16_t, NUM_STATES> parents {};
+	std::array<Action, NUM_STATES> parentActions {};
+	std::array<std::int16_t, NUM_STATES> queue {};
+
+	std::vector<Placement> placements;
+	std::vector<int> placementStates;
+};
+
+#endif // PLACEMENT_HPP
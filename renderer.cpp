@@ -0,0 +1,90 @@
+#include "renderer.hpp"
+#include <ncurses.h>
+#include <algorithm>
+#include <cassert>
+
+
+Renderer::Renderer()
+{
+	// No glyph is ever '\0', so the first frame is drawn in full
+	presented.fill('\0');
+}
+
+
+void Renderer::drawFrame(const Field& field, const Tetromino* t,
+	const Tetromino* ghost)
+{
+	composeFrame(field, t, ghost);
+
+	for (int y = 0; y < FIELD_HEIGHT; y++)
+	{
+		const auto newRow = frame.begin() + (y * FIELD_WIDTH);
+		const auto oldRow = presented.begin() + (y * FIELD_WIDTH);
+		if (std::equal(newRow, newRow + FIELD_WIDTH, oldRow))
+			continue;
+
+		for (int x = 0; x < FIELD_WIDTH; x++)
+		{
+			if (newRow[x] == oldRow[x])
+				continue;
+			mvaddch(y, x, newRow[x]);
+			oldRow[x] = newRow[x];
+		}
+	}
+}
+
+
+void Renderer::drawHUD(const unsigned int score, const unsigned int numLinesCleared,
+	const unsigned int level)
+{
+	if (hudDrawn && score == hudScore && numLinesCleared == hudLines && level == hudLevel)
+		return;
+
+	mvprintw(1, FIELD_WIDTH + 2, "SCORE:");
+	mvprintw(2, FIELD_WIDTH + 2, "%u", score);
+	mvprintw(4, FIELD_WIDTH + 2, "LINES:");
+	mvprintw(5, FIELD_WIDTH + 2, "%u", numLinesCleared);
+	mvprintw(7, FIELD_WIDTH + 2, "LEVEL:");
+	mvprintw(8, FIELD_WIDTH + 2, "%u", level);
+
+	hudDrawn = true;
+	hudScore = score;
+	hudLines = numLinesCleared;
+	hudLevel = level;
+}
+
+
+void Renderer::present()
+{
+	wnoutrefresh(stdscr);
+	doupdate();
+}
+
+
+void Renderer::composeFrame(const Field& field, const Tetromino* t,
+	const Tetromino* ghost)
+{
+	frame = field.glyphs;
+	if (ghost != nullptr)
+		composePiece(*ghost, GHOST_GLYPH);
+	if (t != nullptr)
+		composePiece(*t, t->getMask().glyph);
+}
+
+
+void Renderer::composePiece(const Tetromino& t, const char glyph)
+{
+	const PieceMask& mask = t.getMask();
+	assert(t.x + mask.left >= 0 && t.x + mask.right < FIELD_WIDTH &&
+		t.y + mask.top >= 0 && t.y + mask.bottom < FIELD_HEIGHT);
+	for (int y = mask.top; y <= mask.bottom; y++)
+	{
+		const int frameRow = (t.y + y) * FIELD_WIDTH;
+		for (int x = 0; x <= mask.right - mask.left; x++)
+		{
+			if (((mask.rows[y] >> x) & 1) == 0)
+				continue;
+			frame[frameRow + t.x + mask.left + x] = glyph;
+		}
+	}
+}
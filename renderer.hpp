@@ -0,0 +1,47 @@
+#ifndef RENDERER_HPP
+#define RENDERER_HPP
+
+#include <array>
+#include "field.hpp"
+#include "tetromino.hpp"
+
+// Draws the field, the falling piece and the HUD with ncurses.
+// It remembers the last frame sent to the terminal and only emits
+// the cells whose glyph changed since then: the old and new piece
+// footprints, locked pieces and cleared rows.
+// Drawing only touches the virtual screen; nothing reaches the
+// terminal until present(), which should be called once per frame.
+class Renderer {
+public:
+	Renderer();
+
+	// Pass a null piece to draw the field alone. The ghost, if given,
+	// shows where the piece would land and is drawn underneath it.
+	void drawFrame(const Field& field, const Tetromino* t,
+		const Tetromino* ghost = nullptr);
+
+	// Only rewritten when one of the values changed
+	void drawHUD(const unsigned int score, const unsigned int numLinesCleared,
+		const unsigned int level);
+
+	// Send everything drawn since the last call to the terminal at once
+	void present();
+
+private:
+	static constexpr char GHOST_GLYPH {'.'};
+
+	void composeFrame(const Field& field, const Tetromino* t, const Tetromino* ghost);
+	void composePiece(const Tetromino& t, char glyph);
+
+	// What the next frame should look like
+	std::array<char, FIELD_LENGTH> frame;
+	// What the terminal currently shows
+	std::array<char, FIELD_LENGTH> presented;
+
+	bool hudDrawn {false};
+	unsigned int hudScore {0};
+	unsigned int hudLines {0};
+	unsigned int hudLevel {0};
+};
+
+#endif // RENDERER_HPP
@@ -0,0 +1,199 @@
+#include "replay.hpp"
+#include <algorithm>
+#include <cassert>
+#include <fstream>
+
+
+// Actions take the low bits of each event, and 0 (Action::None) ends the list
+constexpr int ACTION_BITS {3};
+static_assert(static_cast<int>(Action::HardDrop) < (1 << ACTION_BITS),
+	"Actions no longer fit in a replay event");
+
+
+void writeVarint(std::vector<std::uint8_t>& bytes, std::uint64_t value)
+{
+	while (value >= 0x80)
+	{
+		bytes.push_back(static_cast<std::uint8_t>(value | 0x80));
+		value >>= 7;
+	}
+	bytes.push_back(static_cast<std::uint8_t>(value));
+}
+
+
+bool readVarint(const std::uint8_t* data, std::size_t size,
+	std::size_t& pos, std::uint64_t& value)
+{
+	value = 0;
+	for (int shift = 0; shift < 64; shift += 7)
+	{
+		if (pos >= size)
+			return false;
+		const std::uint8_t byte = data[pos++];
+		value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+		if ((byte & 0x80) == 0)
+			return true;
+	}
+	return false;
+}
+
+
+// Read a varint that must fit in an unsigned int
+bool readUint(const std::uint8_t* data, std::size_t size,
+	std::size_t& pos, unsigned int& value)
+{
+	std::uint64_t wide;
+	if (!readVarint(data, size, pos, wide) || wide > 0xffffffffu)
+		return false;
+	value = static_cast<unsigned int>(wide);
+	return true;
+}
+
+
+ReplayRecorder::ReplayRecorder(std::uint64_t seed, int lineClearFrames)
+{
+	assert(isReplayLineClearFrames(lineClearFrames));
+	for (const std::uint8_t byte : REPLAY_MAGIC)
+		bytes.push_back(byte);
+	bytes.push_back(REPLAY_VERSION);
+	for (int i = 0; i < 8; i++)
+		bytes.push_back(static_cast<std::uint8_t>(seed >> (8 * i)));
+	writeVarint(bytes, static_cast<std::uint64_t>(lineClearFrames));
+}
+
+
+void ReplayRecorder::recordInput(const Game& game, Action action)
+{
+	assert(!finished);
+	if (action == Action::None)
+		return;
+
+	const unsigned int frame = game.getFrame();
+	writeVarint(bytes, (std::uint64_t{frame - lastFrame} << ACTION_BITS) |
+		static_cast<std::uint64_t>(action));
+	lastFrame = frame;
+}
+
+
+void ReplayRecorder::finish(const Game& game)
+{
+	assert(!finished);
+	writeVarint(bytes, std::uint64_t{game.getFrame() - lastFrame} << ACTION_BITS);
+	writeVarint(bytes, game.getScore());
+	writeVarint(bytes, game.getLines());
+	lastFrame = game.getFrame();
+	finished = true;
+}
+
+
+bool ReplayRecorder::writeFile(const std::string& path) const
+{
+	std::ofstream file {path, std::ios::binary | std::ios::trunc};
+	file.write(reinterpret_cast<const char*>(bytes.data()),
+		static_cast<std::streamsize>(bytes.size()));
+	return static_cast<bool>(file);
+}
+
+
+bool ReplayReader::open(const std::uint8_t* data, std::size_t size)
+{
+	this->data = data;
+	this->size = size;
+	info = ReplayInfo{};
+
+	constexpr std::size_t seedPos {REPLAY_MAGIC.size() + 1};
+	if (size < seedPos + 8 ||
+		!std::equal(REPLAY_MAGIC.begin(), REPLAY_MAGIC.end(), data) ||
+		data[REPLAY_MAGIC.size()] != REPLAY_VERSION)
+	{
+		return false;
+	}
+	for (int i = 0; i < 8; i++)
+		info.seed |= static_cast<std::uint64_t>(data[seedPos + i]) << (8 * i);
+
+	std::size_t pos {seedPos + 8};
+	unsigned int lineClearFrames;
+	if (!readUint(data, size, pos, lineClearFrames) ||
+		!isReplayLineClearFrames(static_cast<int>(lineClearFrames)))
+	{
+		return false;
+	}
+	info.lineClearFrames = static_cast<int>(lineClearFrames);
+	eventPos = pos;
+
+	// Run through the events once, so that a damaged replay is turned
+	// away here rather than halfway through playing it
+	unsigned int frame {0};
+	Action action;
+	do
+	{
+		if (!readEvent(pos, frame, action))
+			return false;
+	}
+	while (action != Action::None);
+	info.frames = frame;
+
+	if (!readUint(data, size, pos, info.score) ||
+		!readUint(data, size, pos, info.lines) ||
+		pos != size)
+	{
+		return false;
+	}
+
+	eventFrame = 0;
+	readEvent(eventPos, eventFrame, eventAction);
+	return true;
+}
+
+
+void ReplayReader::applyInputs(Game& game)
+{
+	while (eventAction != Action::None && eventFrame <= game.getFrame())
+	{
+		game.input(eventAction);
+		readEvent(eventPos, eventFrame, eventAction);
+	}
+}
+
+
+bool ReplayReader::readEvent(std::size_t& pos, unsigned int& frame, Action& action) const
+{
+	std::uint64_t event;
+	if (!readVarint(data, size, pos, event))
+		return false;
+
+	const std::uint64_t delta = event >> ACTION_BITS;
+	const int code = static_cast<int>(event & ((1 << ACTION_BITS) - 1));
+	if (delta > MAX_FRAMES_WITHOUT_INPUT || frame + delta > MAX_REPLAY_FRAMES ||
+		code > static_cast<int>(Action::HardDrop))
+	{
+		return false;
+	}
+	frame += static_cast<unsigned int>(delta);
+	action = static_cast<Action>(code);
+	return true;
+}
+
+
+bool playReplay(const std::uint8_t* data, std::size_t size,
+	ReplayInfo& recorded, ReplayInfo& played)
+{
+	ReplayReader reader;
+	if (!reader.open(data, size))
+		return false;
+	recorded = reader.getInfo();
+
+	// open() has checked that the game asks for a bounded number of frames
+	Game game {recorded.seed, recorded.lineClearFrames};
+	while (!game.isOver() && game.getFrame() < recorded.frames)
+	{
+		reader.applyInputs(game);
+		game.tick();
+	}
+
+	played = recorded;
+	played.frames = game.getFrame();
+	played.score = game.getScore();
+	played.lines = game.getLines();
+	return true;
+}
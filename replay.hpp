@@ -0,0 +1,111 @@
+#ifndef REPLAY_HPP
+#define REPLAY_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "game.hpp"
+
+// A replay is the seed of a standard game plus every action passed to
+// Game::input(), tagged with the frame it happened on. Since the game is
+// deterministic, that is enough to play it again exactly.
+//
+// Layout, with every number an unsigned LEB128 varint unless noted:
+//   magic "TRPL" (4 bytes), format version (1 byte), seed (8 bytes,
+//   little endian), line clear frames,
+//   events: (frames since the previous event << 3) | action,
+//   end marker: (frames since the previous event << 3) | 0,
+//   final score, final lines.
+// The end marker's frame is the game's last frame. Most events are a
+// single byte, so a game of a few thousand pieces is a few KB.
+constexpr std::array<std::uint8_t, 4> REPLAY_MAGIC {{'T', 'R', 'P', 'L'}};
+constexpr std::uint8_t REPLAY_VERSION {1};
+
+// Limits that keep a replay from asking for more work than a real game.
+// Without input no line is ever cleared, so an untouched game tops out
+// long before MAX_FRAMES_WITHOUT_INPUT (10 minutes at 60 frames per second).
+// Longer gaps between events, and games longer than MAX_REPLAY_FRAMES
+// (4.6 hours), are refused. Only the two line clear lengths the game
+// is played with are accepted.
+constexpr unsigned int MAX_FRAMES_WITHOUT_INPUT {36000};
+constexpr unsigned int MAX_REPLAY_FRAMES {1000000};
+
+constexpr bool isReplayLineClearFrames(int lineClearFrames)
+{
+	return lineClearFrames == 0 || lineClearFrames == Game::DEFAULT_LINE_CLEAR_FRAMES;
+}
+
+// What a replay says about its game
+struct ReplayInfo {
+	std::uint64_t seed {0};
+	int lineClearFrames {0};
+	unsigned int frames {0};
+	unsigned int score {0};
+	unsigned int lines {0};
+};
+
+// Builds a replay in memory while a game is played
+class ReplayRecorder {
+public:
+	explicit ReplayRecorder(std::uint64_t seed,
+		int lineClearFrames = Game::DEFAULT_LINE_CLEAR_FRAMES);
+
+	// Call with every action given to game.input(), before calling it
+	void recordInput(const Game& game, Action action);
+
+	// Add the end marker and the game's results. Call once the game is
+	// over, or whenever recording stops; nothing can be added after.
+	void finish(const Game& game);
+
+	const std::vector<std::uint8_t>& getBytes() const
+	{
+		return bytes;
+	}
+
+	bool writeFile(const std::string& path) const;
+
+private:
+	std::vector<std::uint8_t> bytes;
+	unsigned int lastFrame {0};
+	bool finished {false};
+};
+
+// Feeds a replay's actions back into a game, frame by frame.
+// The replay is read in place; the data must outlive the reader.
+class ReplayReader {
+public:
+	// Check the whole replay and read its header and results.
+	// False if the data is not a replay this build can play.
+	bool open(const std::uint8_t* data, std::size_t size);
+
+	const ReplayInfo& getInfo() const
+	{
+		return info;
+	}
+
+	// Give the game every action recorded for its current frame
+	void applyInputs(Game& game);
+
+private:
+	// Decode the event at pos, advancing pos. False if the data ends first.
+	bool readEvent(std::size_t& pos, unsigned int& frame, Action& action) const;
+
+	const std::uint8_t* data {nullptr};
+	std::size_t size {0};
+	ReplayInfo info;
+
+	// The next event still to be applied
+	std::size_t eventPos {0};
+	unsigned int eventFrame {0};
+	Action eventAction {Action::None};
+};
+
+// Play a replay from start to finish without drawing or waiting.
+// recorded receives what the replay says happened, and played what
+// happened this time. False if the data is not a replay.
+bool playReplay(const std::uint8_t* data, std::size_t size,
+	ReplayInfo& recorded, ReplayInfo& played);
+
+#endif // REPLAY_HPP
@@ -0,0 +1,247 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <type_traits>
+#include "game.hpp"
+#include "bot.hpp"
+#include "thread_pool.hpp"
+#include "replay.hpp"
+
+// Runs many independent headless games across all cores
+// and prints aggregate statistics.
+
+struct SimOptions {
+	unsigned long numGames {10000};
+	unsigned int numThreads {0};
+	std::uint64_t seed {1};
+	unsigned long maxFrames {1000000};
+	// Otherwise the player presses random keys
+	bool useBot {false};
+	// Play on WideGame's board instead of the standard one.
+	// The bot only knows the standard board.
+	bool useWideBoard {false};
+	BotConfig botConfig;
+	// Threads shared by every bot's search; 0 searches on the game's thread
+	unsigned int numSearchThreads {0};
+	// Save a replay of every game in this directory, named by game number
+	std::string recordDir;
+};
+
+struct GameStats {
+	unsigned long lines {0};
+	unsigned long score {0};
+	unsigned long level {0};
+	unsigned long piecesPlaced {0};
+	unsigned long frames {0};
+};
+
+// Mixes the base seed with a game number, so that every game gets its own
+// sequence no matter which thread ends up running it
+std::uint64_t mixSeed(std::uint64_t seed, std::uint64_t gameNum);
+
+// replayPath, if not empty, is where to save a replay of the game
+template <typename GameType>
+GameStats playGame(const std::uint64_t gameSeed, const SimOptions& options,
+	ThreadPool* searchPool, const std::string& replayPath);
+
+bool parseOptions(int argc, char* argv[], SimOptions& options);
+
+int main(int argc, char* argv[])
+{
+	SimOptions options;
+	const bool parsed = parseOptions(argc, argv, options);
+	const bool wideBoardMisused = options.useWideBoard &&
+		(options.useBot || !options.recordDir.empty());
+	const bool replaysTooLong = !options.recordDir.empty() &&
+		options.maxFrames > MAX_REPLAY_FRAMES;
+	if (!parsed || wideBoardMisused || replaysTooLong)
+	{
+		std::cerr << "Usage: " << argv[0]
+			<< " [--games N] [--threads N] [--seed N] [--max-frames N]"
+			<< " [--policy random|bot] [--beam-width N] [--depth N]"
+			<< " [--search-threads N] [--board standard|wide] [--record-dir DIR]\n"
+			<< "The bot and replays only work on the standard board,\n"
+			<< "and replays hold at most " << MAX_REPLAY_FRAMES << " frames.\n";
+		return 1;
+	}
+
+	if (!options.recordDir.empty())
+	{
+		std::error_code error;
+		std::filesystem::create_directories(options.recordDir, error);
+		if (error)
+		{
+			std::cerr << "Could not create " << options.recordDir << ": " << error.message() << "\n";
+			return 1;
+		}
+	}
+
+	ThreadPool pool {options.numThreads};
+	std::unique_ptr<ThreadPool> searchPool;
+	if (options.useBot && options.numSearchThreads > 0)
+		searchPool = std::make_unique<ThreadPool>(options.numSearchThreads);
+
+	// Every game writes only its own slot, so no locking is needed
+	// until the results are gathered after wait()
+	std::vector<GameStats> results(options.numGames);
+	constexpr unsigned long gamesPerTask {64};
+
+	const auto timeStart = std::chrono::steady_clock::now();
+	for (unsigned long first = 0; first < options.numGames; first += gamesPerTask)
+	{
+		const unsigned long last = std::min(first + gamesPerTask, options.numGames);
+		pool.submit([&results, &options, &searchPool, first, last] {
+			for (unsigned long i = first; i < last; i++)
+			{
+				const std::uint64_t gameSeed = mixSeed(options.seed, i);
+				const std::string replayPath = options.recordDir.empty() ? std::string{} :
+					options.recordDir + "/" + std::to_string(i) + ".rpl";
+				if (options.useWideBoard)
+					results[i] = playGame<WideGame>(gameSeed, options, searchPool.get(), replayPath);
+				else
+					results[i] = playGame<Game>(gameSeed, options, searchPool.get(), replayPath);
+			}
+		});
+	}
+	pool.wait();
+	const auto timeEnd = std::chrono::steady_clock::now();
+
+	GameStats total;
+	GameStats best;
+	for (const GameStats& stats : results)
+	{
+		total.lines += stats.lines;
+		total.score += stats.score;
+		total.level += stats.level;
+		total.piecesPlaced += stats.piecesPlaced;
+		total.frames += stats.frames;
+		best.lines = std::max(best.lines, stats.lines);
+		best.score = std::max(best.score, stats.score);
+		best.level = std::max(best.level, stats.level);
+		best.piecesPlaced = std::max(best.piecesPlaced, stats.piecesPlaced);
+		best.frames = std::max(best.frames, stats.frames);
+	}
+
+	const double seconds = std::chrono::duration<double>(timeEnd - timeStart).count();
+	const double numGames = std::max(1.0, static_cast<double>(options.numGames));
+	std::cout << std::fixed << std::setprecision(2)
+		<< "games:   " << options.numGames << " on " << pool.size() << " threads\n"
+		<< "time:    " << seconds << " s ("
+		<< options.numGames / seconds << " games/s, "
+		<< total.frames / seconds << " frames/s)\n"
+		<< "         mean      max\n"
+		<< "lines:   " << std::setw(8) << total.lines / numGames << " " << best.lines << "\n"
+		<< "score:   " << std::setw(8) << total.score / numGames << " " << best.score << "\n"
+		<< "level:   " << std::setw(8) << total.level / numGames << " " << best.level << "\n"
+		<< "pieces:  " << std::setw(8) << total.piecesPlaced / numGames << " " << best.piecesPlaced << "\n";
+	return 0;
+}
+
+
+std::uint64_t mixSeed(std::uint64_t seed, std::uint64_t gameNum)
+{
+	// SplitMix64 finalizer
+	std::uint64_t z = seed + (gameNum + 1) * 0x9e3779b97f4a7c15;
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+	return z ^ (z >> 31);
+}
+
+
+template <typename GameType>
+GameStats playGame(const std::uint64_t gameSeed, const SimOptions& options,
+	ThreadPool* searchPool, const std::string& replayPath)
+{
+	// Nobody watches these games, so lines are removed without animation
+	GameType game {gameSeed, 0};
+	ReplayRecorder recorder {gameSeed, 0};
+
+	// The bot gets as long as it needs, which keeps its games deterministic
+	Bot bot {options.botConfig, searchPool};
+	Pcg32 policyRng {gameSeed, 1};
+	const auto numActions = static_cast<std::uint32_t>(Action::RotateCW) + 1;
+
+	GameStats stats;
+	while (!game.isOver() && stats.frames < options.maxFrames)
+	{
+		Action action {Action::None};
+		if constexpr (std::is_same_v<GameType, Game>)
+		{
+			if (options.useBot)
+				action = bot.chooseAction(game, Bot::Clock::time_point::max());
+		}
+		if (!options.useBot)
+			action = static_cast<Action>(policyRng.bounded(numActions));
+		if constexpr (std::is_same_v<GameType, Game>)
+		{
+			if (!replayPath.empty())
+				recorder.recordInput(game, action);
+		}
+		game.step(action);
+		stats.frames++;
+	}
+
+	if constexpr (std::is_same_v<GameType, Game>)
+	{
+		if (!replayPath.empty())
+		{
+			recorder.finish(game);
+			if (!recorder.writeFile(replayPath))
+				std::cerr << "Could not write " << replayPath << "\n";
+		}
+	}
+
+	stats.piecesPlaced = game.getPiecesPlaced();
+	stats.lines = game.getLines();
+	stats.score = game.getScore();
+	stats.level = game.getLevel();
+	return stats;
+}
+
+
+bool parseOptions(int argc, char* argv[], SimOptions& options)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		const std::string arg {argv[i]};
+		if (i + 1 >= argc)
+			return false;
+		const std::string value {argv[++i]};
+		try
+		{
+			if (arg == "--games")
+				options.numGames = std::stoul(value);
+			else if (arg == "--threads")
+				options.numThreads = std::stoul(value);
+			else if (arg == "--seed")
+				options.seed = std::stoull(value);
+			else if (arg == "--max-frames")
+				options.maxFrames = std::stoul(value);
+			else if (arg == "--policy" && (value == "random" || value == "bot"))
+				options.useBot = (value == "bot");
+			else if (arg == "--beam-width" && std::stoi(value) >= 1)
+				options.botConfig.beamWidth = std::stoi(value);
+			else if (arg == "--depth" && std::stoi(value) >= 1)
+				options.botConfig.depth = std::stoi(value);
+			else if (arg == "--search-threads")
+				options.numSearchThreads = std::stoul(value);
+			else if (arg == "--board" && (value == "standard" || value == "wide"))
+				options.useWideBoard = (value == "wide");
+			else if (arg == "--record-dir")
+				options.recordDir = value;
+			else
+				return false;
+		}
+		catch (const std::exception&)
+		{
+			return false;
+		}
+	}
+	return true;
+}
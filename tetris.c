@@ -2,6 +2,8 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
 #include <time.h>
 
 int const FIELD_WIDTH = 12;
@@ -21,8 +23,7 @@ void drawField(char field[const FIELD_LENGTH]);
 
 void drawHUD(int const score, int const numLinesCleared, int const level);
 
-void clearLinesFromField(char field[const FIELD_LENGTH],
-	int numLinesToClear, int lowestLineToClear);
+void clearLinesFromField(char field[const FIELD_LENGTH], int lowestLineToClear);
 
 void drawPiece(struct tetromino const*const t);
 
@@ -76,12 +77,56 @@ int getPieceIndexForRotation(struct tetromino const*const t,
 
 bool pieceCanFit(char field[const FIELD_LENGTH], struct tetromino const*const t);
 
-void shuffleArray(int bag[static 7]);
+// PCG32 (XSH RR variant), from https://www.pcg-random.org
+// Must stay identical to Pcg32 in piece_generator.hpp so that
+// both builds deal the same pieces for the same seed.
+struct pcg32 {
+	uint64_t state;
+	uint64_t inc;
+};
+
+void pcg32Seed(struct pcg32* rng, uint64_t seed);
+
+uint32_t pcg32Next(struct pcg32* rng);
+
+uint32_t pcg32Bounded(struct pcg32* rng, uint32_t bound);
+
+// Deals tetrominoes in shuffled bags of all seven pieces
+struct pieceGenerator {
+	struct pcg32 rng;
+	int pieceBag[7];
+	int currentBagIndex;
+};
+
+void pieceGeneratorInit(struct pieceGenerator* gen, uint64_t seed);
+
+int pieceGeneratorNext(struct pieceGenerator* gen);
+
+void shuffleArray(struct pcg32* rng, int bag[static 7]);
 
 long getTimeDiff(struct timespec* start, struct timespec* stop);
 
-int main(void)
+void waitForFrameEnd(struct timespec* start, long const nsPerFrame);
+
+int main(int argc, char* argv[])
 {
+	// Seed from the clock unless one is given, so any game can be replayed
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	uint64_t seed = ((uint64_t)now.tv_sec * 1000000000u) + now.tv_nsec;
+	for (int i = 1; i < argc; i++)
+	{
+		char* end = NULL;
+		if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+		{
+			seed = strtoull(argv[++i], &end, 10);
+			if (*end == '\0')
+				continue;
+		}
+		fprintf(stderr, "Usage: %s [--seed N]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
 	// ----------------
 	// Piece "sprites"
 	// ----------------
@@ -131,15 +176,14 @@ int main(void)
 	// Make cursor invisible
 	curs_set(0);
 
-	// Initialize the array with a random tetromino sequence
-	int pieceBag[7] = {0, 1, 2, 3, 4, 5, 6};
-	shuffleArray(pieceBag);
+	// Initialize the generator of the tetromino sequence
+	struct pieceGenerator pieceGen;
+	pieceGeneratorInit(&pieceGen, seed);
 
 	// --------------------
 	// Game state variables
 	// --------------------
-	int currentBagIndex = 0;
-	int currentPieceNum = pieceBag[currentBagIndex];
+	int currentPieceNum = pieceGeneratorNext(&pieceGen);
 	struct tetromino t = {
 		//tetrominoLengths[currentPieceNum],
 		tetrominoSideLengths[currentPieceNum],
@@ -160,8 +204,13 @@ int main(void)
 	int numTicks = 0;
 	int maxTicksPerLine = 48;
 	struct timespec start;
-	struct timespec stop;
 	long const nsPerFrame = 16666667;
+
+	// Line clear animation, 600 ms at 60 frames per second
+	int const lineClearFrames = 36;
+	int clearFramesLeft = 0;
+	int numLinesToClear = 0;
+	int lowestLineToClear = 0;
 	
 	// Ensure game begins with the screen drawn
 	drawField(field);
@@ -171,6 +220,58 @@ int main(void)
 	while (!gameOver)
 	{
 		clock_gettime(CLOCK_MONOTONIC, &start);
+
+		// While full lines are shown, gravity is paused
+		// and keys stay queued in curses until they are gone
+		if (clearFramesLeft > 0)
+		{
+			clearFramesLeft--;
+			if (clearFramesLeft == 0)
+			{
+				// Keep track of player progress
+				totalNumLinesCleared += numLinesToClear;
+
+				// Scoring system similar to original Nintendo system
+				int const scoringLevel = level + 1;
+				switch (numLinesToClear)
+				{
+				case 1:
+					score += 40 * scoringLevel;
+					break;
+				case 2:
+					score += 100 * scoringLevel;
+					break;
+				case 3:
+					score += 300 * scoringLevel;
+					break;
+				case 4:
+					score += 1200 * scoringLevel;
+					break;
+				}
+
+				// Check if level should advance
+				tenLineCounter += numLinesToClear;
+				if (tenLineCounter >= 10)
+				{
+					level++;
+					tenLineCounter -= 10;
+					// Adjust timing
+					if (level < 8 && maxTicksPerLine > 5)
+						maxTicksPerLine -= 5;
+					else if (maxTicksPerLine > 1)
+						maxTicksPerLine--;
+				}
+
+				clearLinesFromField(field, lowestLineToClear);
+				numLinesToClear = 0;
+				lowestLineToClear = 0;
+				drawField(field);
+				drawHUD(score, totalNumLinesCleared, level);
+			}
+			waitForFrameEnd(&start, nsPerFrame);
+			continue;
+		}
+
 		shouldForceDownward = (numTicks >= maxTicksPerLine);
 
 		// Process input
@@ -232,9 +333,6 @@ int main(void)
 			shouldForceDownward = false;
 		}
 
-		int numLinesToClear = 0;
-		int lowestLineToClear = 0;
-
 		if (!shouldFixInPlace)
 		{
 			drawField(field);
@@ -303,13 +401,7 @@ int main(void)
 			drawField(field);
 
 			// Update game state
-			currentBagIndex++;
-			if (currentBagIndex >= 7)
-			{
-				currentBagIndex = 0;
-				shuffleArray(pieceBag);
-			}
-			currentPieceNum = pieceBag[currentBagIndex];
+			currentPieceNum = pieceGeneratorNext(&pieceGen);
 			//t.len = tetrominoLengths[currentPieceNum];
 			t.sidelen = tetrominoSideLengths[currentPieceNum];
 			t.x = 4;
@@ -320,66 +412,20 @@ int main(void)
 
 		if (numLinesToClear > 0)
 		{
-			// Must draw the screen once again
-			// to show the lines disappearing.
-
-			// First, wait for a short duration
-			// so the player can see the effect.
-			struct timespec sleepTime = {0, 600000000};
-			nanosleep(&sleepTime, &sleepTime);
-
-			// Keep track of player progress
-			totalNumLinesCleared += numLinesToClear;
-
-			// Scoring system similar to original Nintendo system
-			int const scoringLevel = level + 1;
-			switch (numLinesToClear)
-			{
-			case 1:
-				score += 40 * scoringLevel;
-				break;
-			case 2:
-				score += 100 * scoringLevel;
-				break;
-			case 3:
-				score += 300 * scoringLevel;
-				break;
-			case 4:
-				score += 1200 * scoringLevel;
-				break;
-			}
-
-			// Check if level should advance
-			tenLineCounter += numLinesToClear;
-			if (tenLineCounter >= 10)
-			{
-				level++;
-				tenLineCounter -= 10;
-				// Adjust timing
-				if (level < 8 && maxTicksPerLine > 5)
-					maxTicksPerLine -= 5;
-				else if (maxTicksPerLine > 1)
-					maxTicksPerLine--;
-			}
-
-			clearLinesFromField(field, numLinesToClear, lowestLineToClear);
-			drawField(field);
-			drawHUD(score, totalNumLinesCleared, level);
+			// Leave the full lines on screen for a short duration
+			// so the player can see the effect. The frames keep going
+			// and the lines are removed once the duration is over.
+			clearFramesLeft = lineClearFrames;
 		}
  
 		numTicks++;
 		// Wait if necessary to maintain roughly 60 loops per second
-		clock_gettime(CLOCK_MONOTONIC, &stop);
-		long const nsElapsed = getTimeDiff(&start, &stop);
-		if (nsElapsed < nsPerFrame)
-		{
-			struct timespec sleepTime = {0, nsPerFrame - nsElapsed};
-			nanosleep(&sleepTime, &sleepTime);
-		}
+		waitForFrameEnd(&start, nsPerFrame);
 	}
 
 	endwin();
 	printf("Final score: %d\n", score);
+	printf("Seed: %llu\n", (unsigned long long)seed);
 	return EXIT_SUCCESS;
 }
 
@@ -412,55 +458,27 @@ void drawHUD(int const score, int const numLinesCleared, int const level)
 }
 
 
-void clearLinesFromField(char field[FIELD_LENGTH],
-	int numLinesToClear, int lowestLineToClear)
+void clearLinesFromField(char field[FIELD_LENGTH], int lowestLineToClear)
 {
-	while (numLinesToClear > 0)
+	// Walk up from the lowest full line, moving every other row down
+	// past the full lines ('=') found below it. Each row is copied once,
+	// and only rows that were already read are overwritten.
+	int const rowLength = FIELD_WIDTH - 2;
+	int writeY = lowestLineToClear;
+	for (int readY = lowestLineToClear; readY >= 0; readY--)
 	{
-		// Get number of lines to move down
-		int numFullContiguousLines = 1;
-		int const charAboveIndex = ((lowestLineToClear - 1) * FIELD_WIDTH) + 1;
-		for (int i = charAboveIndex; field[i] == '='; i -= FIELD_WIDTH)
-		{
-			numFullContiguousLines++;
-		}
-		
-		// This offset designates how far away in the field array
-		// the old elements that must be moved down/ahead are
-		int const oldYOffset = numFullContiguousLines * FIELD_WIDTH;
+		char const* oldRow = field + (readY * FIELD_WIDTH) + 1;
+		if (*oldRow == '=')
+			continue;
 
-		// Move everything in the field array down
-		for (int y = lowestLineToClear; y >= 0; y--)
-		{
-			int const fieldYOffset = y * FIELD_WIDTH;
-			for (int x = 1; x < FIELD_WIDTH - 1; x++)
-			{
-				int const newFieldIndex = fieldYOffset + x;
-				if (y <= numFullContiguousLines)
-				{
-					field[newFieldIndex] = ' ';
-				}
-				else
-				{
-					int const oldFieldIndex = newFieldIndex - oldYOffset;
-					field[newFieldIndex] = field[oldFieldIndex];
-				}
-			}
-		}
-
-		numLinesToClear -= numFullContiguousLines;
-		if (numLinesToClear > 0)
-		{
-			// Find the next line that needs to be cleared
-			int fieldIndex;
-			do
-			{
-				lowestLineToClear--;
-				fieldIndex = (lowestLineToClear * FIELD_WIDTH) + 1;
-			}
-			while (field[fieldIndex] != '=');
-		}
+		if (writeY != readY)
+			memcpy(field + (writeY * FIELD_WIDTH) + 1, oldRow, rowLength);
+		writeY--;
 	}
+
+	// What is left at the top was emptied by the lines that went away
+	for (; writeY >= 0; writeY--)
+		memset(field + (writeY * FIELD_WIDTH) + 1, ' ', rowLength);
 }
 
 
@@ -552,12 +570,66 @@ bool pieceCanFit(char field[const FIELD_LENGTH], struct tetromino const*const t)
 }
 
 
-void shuffleArray(int bag[static 7])
+void pcg32Seed(struct pcg32* rng, uint64_t seed)
+{
+	rng->state = 0;
+	rng->inc = (0xda3e39cb94b95bdbULL << 1) | 1;
+	pcg32Next(rng);
+	rng->state += seed;
+	pcg32Next(rng);
+}
+
+
+uint32_t pcg32Next(struct pcg32* rng)
+{
+	uint64_t const oldState = rng->state;
+	rng->state = oldState * 6364136223846793005ULL + rng->inc;
+	uint32_t const xorShifted = (uint32_t)(((oldState >> 18) ^ oldState) >> 27);
+	uint32_t const rot = (uint32_t)(oldState >> 59);
+	return (xorShifted >> rot) | (xorShifted << ((32 - rot) & 31));
+}
+
+
+uint32_t pcg32Bounded(struct pcg32* rng, uint32_t bound)
+{
+	// Reject the low values that would bias the modulo
+	uint32_t const threshold = (0u - bound) % bound;
+	while (true)
+	{
+		uint32_t const r = pcg32Next(rng);
+		if (r >= threshold)
+			return r % bound;
+	}
+}
+
+
+void pieceGeneratorInit(struct pieceGenerator* gen, uint64_t seed)
+{
+	pcg32Seed(&gen->rng, seed);
+	for (int i = 0; i < 7; i++)
+		gen->pieceBag[i] = i;
+	// Start past the end so the first call shuffles
+	gen->currentBagIndex = 7;
+}
+
+
+int pieceGeneratorNext(struct pieceGenerator* gen)
+{
+	if (gen->currentBagIndex >= 7)
+	{
+		shuffleArray(&gen->rng, gen->pieceBag);
+		gen->currentBagIndex = 0;
+	}
+	return gen->pieceBag[gen->currentBagIndex++];
+}
+
+
+void shuffleArray(struct pcg32* rng, int bag[static 7])
 {
 	// Fisher-Yates shuffle
 	for (int i = 6; i >= 1; i--)
 	{
-		int const j = arc4random_uniform(i + 1);
+		int const j = pcg32Bounded(rng, i + 1);
 		int const temp = bag[i];
 		bag[i] = bag[j];
 		bag[j] = temp;
@@ -572,3 +644,16 @@ long getTimeDiff(struct timespec* start, struct timespec* stop)
 	long const stop_nsec = stop->tv_nsec + (stop->tv_sec * ns_per_s);
 	return stop_nsec - start_nsec;
 }
+
+
+void waitForFrameEnd(struct timespec* start, long const nsPerFrame)
+{
+	struct timespec stop;
+	clock_gettime(CLOCK_MONOTONIC, &stop);
+	long const nsElapsed = getTimeDiff(start, &stop);
+	if (nsElapsed < nsPerFrame)
+	{
+		struct timespec sleepTime = {0, nsPerFrame - nsElapsed};
+		nanosleep(&sleepTime, &sleepTime);
+	}
+}
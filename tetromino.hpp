@@ -0,0 +1,327 @@
+#ifndef TETROMINO_HPP
+#define TETROMINO_HPP
+
+#include <array>
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <type_traits>
+
+// Piece "sprites"
+// Based on the Super Rotation System:
+// https://tetris.fandom.com/wiki/SRS
+constexpr std::array<const char*, 7> tetrominoes {{
+	"    IIII        ",
+	"ZZ  ZZ   ",
+	" SSSS    ",
+	"OOOO",
+	" T TTT   ",
+	"  LLLL   ",
+	"J  JJJ   "
+}};
+constexpr std::array<int, 7> tetrominoSideLengths {{4, 3, 3, 2, 3, 3, 3}};
+
+//=================
+// ROTATION TABLES
+//=================
+// For 3x3 shapes:
+constexpr std::array<std::array<std::array<int, 3>, 3>, 4> threeRot {{
+	// 0 degrees:
+	{{ {{0, 1, 2}},
+	   {{3, 4, 5}},
+	   {{6, 7, 8}} }},
+	// 90 degrees:
+	{{ {{6, 3, 0}},
+	   {{7, 4, 1}},
+	   {{8, 5, 2}} }},
+	// 180 degrees:
+	{{ {{8, 7, 6}},
+	   {{5, 4, 3}},
+	   {{2, 1, 0}} }},
+	// 270 degrees:
+	{{ {{2, 5, 8}},
+	   {{1, 4, 7}},
+	   {{0, 3, 6}} }}
+}};
+// For 4x4 shapes:
+constexpr std::array<std::array<std::array<int, 4>, 4>, 4> fourRot {{
+	// 0 degrees:
+	{{ {{ 0,  1,  2,  3}},
+	   {{ 4,  5,  6,  7}},
+	   {{ 8,  9, 10, 11}},
+	   {{12, 13, 14, 15}} }},
+	// 90 degrees:
+	{{ {{12,  8,  4,  0}},
+	   {{13,  9,  5,  1}},
+	   {{14, 10,  6,  2}},
+	   {{15, 11,  7,  3}} }},
+	// 180 degrees:
+	{{ {{15, 14, 13, 12}},
+	   {{11, 10,  9,  8}},
+	   {{ 7,  6,  5,  4}},
+	   {{ 3,  2,  1,  0}} }},
+	// 270 degrees:
+	{{ {{ 3,  7, 11, 15}},
+	   {{ 2,  6, 10, 14}},
+	   {{ 1,  5,  9, 13}},
+	   {{ 0,  4,  8, 12}} }}
+}};
+
+constexpr int getPieceIndexForRotation(const int sidelen, const int rot,
+	const int x, const int y)
+{
+	int index {0};
+
+	/*
+	// Old method using arithmetic:
+	// The "O" tetromino's rotation is irrelevant
+	if (sidelen < 3)
+		return index;
+	const int spriteLen = sidelen * sidelen;
+	switch (rot)
+	{
+	case 0:
+		index = (y * sidelen) + x;
+		break;
+	case 1:
+		index = (spriteLen - sidelen) + y - (x * sidelen);
+		break;
+	case 2:
+		index = (spriteLen - 1) - (y * sidelen) - x;
+		break;
+	case 3:
+		index = (sidelen - 1) - y + (x * sidelen);
+		break;
+	}
+	*/
+
+	// New method using tables:
+	switch (sidelen)
+	{
+	case 2:
+		// The "O" tetromino's rotation is irrelevant
+		index = (y * sidelen) + x;
+		break;
+	case 3:
+		index = threeRot[rot][y][x];
+		break;
+	case 4:
+		index = fourRot[rot][y][x];
+		break;
+	default:
+		break;
+	}
+
+	return index;
+}
+
+//=============
+// PIECE MASKS
+//=============
+// Every (piece, rotation) pair as one bitmask per sprite row,
+// generated at compile time from the sprites and rotation tables above.
+// Row bits are shifted so that bit 0 is the leftmost occupied column,
+// which lets a mask be placed with a single shift by (x + left).
+// Rows are widened to the field's row type when they are placed.
+using PieceRow = std::uint8_t;
+
+struct PieceMask {
+	std::array<PieceRow, 4> rows;
+	// Bounding box of the occupied cells, in sprite coordinates (inclusive)
+	int left;
+	int right;
+	int top;
+	int bottom;
+	char glyph;
+	// Lowest occupied row of each column, counted from the left of the
+	// bounding box, -1 past its right edge
+	std::array<int, 4> columnBottoms;
+};
+
+constexpr PieceMask makePieceMask(const int tnum, const int rot)
+{
+	const int sidelen = tetrominoSideLengths[tnum];
+	const char* sprite = tetrominoes[tnum];
+
+	PieceMask mask {{{0, 0, 0, 0}}, sidelen, -1, sidelen, -1, ' ', {{-1, -1, -1, -1}}};
+	for (int y = 0; y < sidelen; y++)
+	{
+		for (int x = 0; x < sidelen; x++)
+		{
+			const char charSprite = sprite[getPieceIndexForRotation(sidelen, rot, x, y)];
+			if (charSprite == ' ')
+				continue;
+			mask.rows[y] |= static_cast<PieceRow>(1u << x);
+			mask.left = std::min(mask.left, x);
+			mask.right = std::max(mask.right, x);
+			mask.top = std::min(mask.top, y);
+			mask.bottom = std::max(mask.bottom, y);
+			mask.glyph = charSprite;
+		}
+	}
+	for (int y = 0; y < sidelen; y++)
+	{
+		mask.rows[y] = static_cast<PieceRow>(mask.rows[y] >> mask.left);
+		for (int x = 0; x <= mask.right - mask.left; x++)
+		{
+			if ((mask.rows[y] >> x) & 1)
+				mask.columnBottoms[x] = y;
+		}
+	}
+
+	return mask;
+}
+
+constexpr std::array<std::array<PieceMask, 4>, 7> makePieceMasks()
+{
+	std::array<std::array<PieceMask, 4>, 7> masks {};
+	for (int tnum = 0; tnum < 7; tnum++)
+		for (int rot = 0; rot < 4; rot++)
+			masks[tnum][rot] = makePieceMask(tnum, rot);
+	return masks;
+}
+
+constexpr std::array<std::array<PieceMask, 4>, 7> pieceMasks {makePieceMasks()};
+
+static_assert(pieceMasks[0][1].rows[0] == 1 && pieceMasks[0][1].left == 2 &&
+	pieceMasks[0][1].top == 0 && pieceMasks[0][1].bottom == 3,
+	"Vertical I piece mask is wrong");
+static_assert(pieceMasks[4][0].rows[1] == 0x7 && pieceMasks[4][0].bottom == 1,
+	"Spawn T piece mask is wrong");
+static_assert(pieceMasks[4][2].columnBottoms[0] == 1 && pieceMasks[4][2].columnBottoms[1] == 2 &&
+	pieceMasks[4][2].columnBottoms[3] == -1,
+	"Upside down T piece column bottoms are wrong");
+
+// Two rotations have the same shape when their masks are equal once
+// aligned to the top of their bounding boxes
+constexpr bool haveSameShape(const PieceMask& a, const PieceMask& b)
+{
+	if (a.bottom - a.top != b.bottom - b.top)
+		return false;
+	for (int y = 0; y <= a.bottom - a.top; y++)
+		if (a.rows[a.top + y] != b.rows[b.top + y])
+			return false;
+	return true;
+}
+
+// For each (piece, rotation), the lowest rotation with the same shape.
+// The O piece has one shape, and I, S and Z have two.
+constexpr std::array<std::array<int, 4>, 7> makeCanonicalRotations()
+{
+	std::array<std::array<int, 4>, 7> canonical {};
+	for (int tnum = 0; tnum < 7; tnum++)
+	{
+		for (int rot = 0; rot < 4; rot++)
+		{
+			canonical[tnum][rot] = rot;
+			for (int other = 0; other < rot; other++)
+			{
+				if (haveSameShape(pieceMasks[tnum][rot], pieceMasks[tnum][other]))
+				{
+					canonical[tnum][rot] = other;
+					break;
+				}
+			}
+		}
+	}
+	return canonical;
+}
+
+constexpr std::array<std::array<int, 4>, 7> canonicalRotations {makeCanonicalRotations()};
+
+static_assert(canonicalRotations[3][3] == 0 && canonicalRotations[0][2] == 0 &&
+	canonicalRotations[0][3] == 1 && canonicalRotations[4][2] == 2,
+	"Rotation symmetry table is wrong");
+
+//============
+// WALL KICKS
+//============
+// When a rotation is blocked, SRS tries the rotated piece at up to four
+// other offsets, in order, and keeps the first that fits.
+// Offsets are (dx, dy) as listed on the wiki above, with dy pointing up;
+// the field's y points down, so tryRotate() subtracts dy.
+// Indexed by [starting rotation][0 for clockwise, 1 for counterclockwise].
+struct KickOffset {
+	int dx;
+	int dy;
+};
+
+constexpr int NUM_KICK_TESTS {5};
+using KickTable = std::array<std::array<std::array<KickOffset, NUM_KICK_TESTS>, 2>, 4>;
+
+// J, L, S, T and Z
+constexpr KickTable jlstzKicks {{
+	{{ {{ {0, 0}, {-1, 0}, {-1,  1}, {0, -2}, {-1, -2} }},    // 0 -> R
+	   {{ {0, 0}, { 1, 0}, { 1,  1}, {0, -2}, { 1, -2} }} }}, // 0 -> L
+	{{ {{ {0, 0}, { 1, 0}, { 1, -1}, {0,  2}, { 1,  2} }},    // R -> 2
+	   {{ {0, 0}, { 1, 0}, { 1, -1}, {0,  2}, { 1,  2} }} }}, // R -> 0
+	{{ {{ {0, 0}, { 1, 0}, { 1,  1}, {0, -2}, { 1, -2} }},    // 2 -> L
+	   {{ {0, 0}, {-1, 0}, {-1,  1}, {0, -2}, {-1, -2} }} }}, // 2 -> R
+	{{ {{ {0, 0}, {-1, 0}, {-1, -1}, {0,  2}, {-1,  2} }},    // L -> 0
+	   {{ {0, 0}, {-1, 0}, {-1, -1}, {0,  2}, {-1,  2} }} }}  // L -> 2
+}};
+
+constexpr KickTable iKicks {{
+	{{ {{ {0, 0}, {-2, 0}, { 1, 0}, {-2, -1}, { 1,  2} }},    // 0 -> R
+	   {{ {0, 0}, {-1, 0}, { 2, 0}, {-1,  2}, { 2, -1} }} }}, // 0 -> L
+	{{ {{ {0, 0}, {-1, 0}, { 2, 0}, {-1,  2}, { 2, -1} }},    // R -> 2
+	   {{ {0, 0}, { 2, 0}, {-1, 0}, { 2,  1}, {-1, -2} }} }}, // R -> 0
+	{{ {{ {0, 0}, { 2, 0}, {-1, 0}, { 2,  1}, {-1, -2} }},    // 2 -> L
+	   {{ {0, 0}, { 1, 0}, {-2, 0}, { 1, -2}, {-2,  1} }} }}, // 2 -> R
+	{{ {{ {0, 0}, { 1, 0}, {-2, 0}, { 1, -2}, {-2,  1} }},    // L -> 0
+	   {{ {0, 0}, {-2, 0}, { 1, 0}, {-2, -1}, { 1,  2} }} }}  // L -> 2
+}};
+
+// Kicking a rotation in one direction and back must undo the offset
+constexpr bool kicksAreSymmetric(const KickTable& kicks)
+{
+	for (int rot = 0; rot < 4; rot++)
+	{
+		const int cwRot = (rot + 1) % 4;
+		for (int i = 0; i < NUM_KICK_TESTS; i++)
+		{
+			const KickOffset& there = kicks[rot][0][i];
+			const KickOffset& back = kicks[cwRot][1][i];
+			if (there.dx != -back.dx || there.dy != -back.dy)
+				return false;
+		}
+	}
+	return true;
+}
+
+static_assert(kicksAreSymmetric(jlstzKicks) && kicksAreSymmetric(iKicks),
+	"Wall kick tables are inconsistent");
+
+// A live piece is only its type, position and rotation, four bytes in all.
+// Its masks are the same for every piece of that type
+// and are looked up in the constexpr tables above, so spawning or copying
+// a piece never allocates. Positions fit in a byte on any board up to
+// 127 cells in either direction.
+class Tetromino {
+public:
+	std::int8_t tnum {};
+	std::int8_t x {4};
+	std::int8_t y {1};
+	std::int8_t rot {0};
+
+	constexpr Tetromino(int tnum)
+		: tnum{static_cast<std::int8_t>(tnum)}
+	{
+		assert(tnum >= 0 && tnum < 7);
+	}
+
+	void reset(int tnum)
+	{
+		*this = Tetromino{tnum};
+	}
+
+	const PieceMask& getMask() const
+	{
+		return pieceMasks[tnum][rot];
+	}
+};
+
+static_assert(sizeof(Tetromino) == 4 && std::is_trivially_copyable_v<Tetromino>,
+	"A live piece should be four plain bytes");
+
+#endif // TETROMINO_HPP
@@ -0,0 +1,230 @@
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Tasks that can be waited for together with ThreadPool::wait(group)
+class TaskGroup {
+public:
+	TaskGroup() = default;
+	TaskGroup(const TaskGroup&) = delete;
+	TaskGroup& operator=(const TaskGroup&) = delete;
+
+private:
+	friend class ThreadPool;
+	std::atomic<int> numUnfinished {0};
+};
+
+// A fixed set of worker threads, each with its own task deque.
+// A worker takes tasks from the back of its own deque and,
+// once that is empty, steals from the front of the others.
+// Tasks submitted from inside a task go to the submitting worker's
+// own deque, so nested work stays on the same core unless stolen.
+class ThreadPool {
+public:
+	explicit ThreadPool(unsigned int numThreads = 0);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	void submit(std::function<void()> task, TaskGroup* group = nullptr);
+
+	// Block until every submitted task has finished
+	void wait();
+
+	// Block until every task in the group has finished, running queued
+	// tasks on this thread in the meantime. Safe to call from a task.
+	void wait(TaskGroup& group);
+
+	unsigned int size() const
+	{
+		return static_cast<unsigned int>(workers.size());
+	}
+
+private:
+	struct Task {
+		std::function<void()> function;
+		TaskGroup* group;
+	};
+
+	struct Worker {
+		std::mutex mutex;
+		std::deque<Task> tasks;
+	};
+
+	void workerLoop(unsigned int index);
+	bool tryPop(unsigned int index, Task& task);
+	bool trySteal(unsigned int index, Task& task);
+	void runTask(Task& task);
+
+	std::vector<std::unique_ptr<Worker>> workers;
+	std::vector<std::thread> threads;
+	std::atomic<unsigned int> nextWorker {0};
+
+	// Which pool and worker the calling thread belongs to, if any
+	static inline thread_local ThreadPool* currentPool {nullptr};
+	static inline thread_local unsigned int currentWorker {0};
+
+	// Tasks sitting in a deque, and tasks not yet finished
+	std::atomic<int> numQueued {0};
+	std::atomic<int> numUnfinished {0};
+	bool stopping {false};
+
+	std::mutex sleepMutex;
+	// Signalled when a task is queued or a group finishes
+	std::condition_variable wakeup;
+	std::condition_variable allDone;
+};
+
+
+inline ThreadPool::ThreadPool(unsigned int numThreads)
+{
+	if (numThreads == 0)
+		numThreads = std::max(1u, std::thread::hardware_concurrency());
+
+	for (unsigned int i = 0; i < numThreads; i++)
+		workers.push_back(std::make_unique<Worker>());
+	for (unsigned int i = 0; i < numThreads; i++)
+		threads.emplace_back(&ThreadPool::workerLoop, this, i);
+}
+
+
+inline ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		stopping = true;
+	}
+	wakeup.notify_all();
+	for (std::thread& thread : threads)
+		thread.join();
+}
+
+
+inline void ThreadPool::submit(std::function<void()> task, TaskGroup* group)
+{
+	numUnfinished++;
+	if (group != nullptr)
+		group->numUnfinished++;
+
+	const unsigned int index = (currentPool == this) ?
+		currentWorker : nextWorker++ % workers.size();
+	Worker& worker = *workers[index];
+	{
+		std::lock_guard<std::mutex> lock(worker.mutex);
+		worker.tasks.push_back(Task{std::move(task), group});
+	}
+	numQueued++;
+
+	// Taking the lock orders this wakeup after any sleeper's check
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+	}
+	wakeup.notify_one();
+}
+
+
+inline void ThreadPool::wait()
+{
+	std::unique_lock<std::mutex> lock(sleepMutex);
+	allDone.wait(lock, [this] { return numUnfinished == 0; });
+}
+
+
+inline void ThreadPool::wait(TaskGroup& group)
+{
+	const unsigned int index = (currentPool == this) ? currentWorker : 0;
+	while (group.numUnfinished > 0)
+	{
+		Task task;
+		if (tryPop(index, task) || trySteal(index, task))
+		{
+			runTask(task);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(sleepMutex);
+		wakeup.wait(lock, [this, &group] {
+			return group.numUnfinished == 0 || numQueued > 0;
+		});
+	}
+}
+
+
+inline void ThreadPool::workerLoop(unsigned int index)
+{
+	currentPool = this;
+	currentWorker = index;
+	while (true)
+	{
+		Task task;
+		if (tryPop(index, task) || trySteal(index, task))
+		{
+			runTask(task);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(sleepMutex);
+		wakeup.wait(lock, [this] { return stopping || numQueued > 0; });
+		if (stopping && numQueued == 0)
+			return;
+	}
+}
+
+
+inline void ThreadPool::runTask(Task& task)
+{
+	task.function();
+
+	const bool groupDone = (task.group != nullptr) && (--task.group->numUnfinished == 0);
+	const bool poolDone = (--numUnfinished == 0);
+	if (groupDone || poolDone)
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		if (groupDone)
+			wakeup.notify_all();
+		if (poolDone)
+			allDone.notify_all();
+	}
+}
+
+
+inline bool ThreadPool::tryPop(unsigned int index, Task& task)
+{
+	Worker& worker = *workers[index];
+	std::lock_guard<std::mutex> lock(worker.mutex);
+	if (worker.tasks.empty())
+		return false;
+	task = std::move(worker.tasks.back());
+	worker.tasks.pop_back();
+	numQueued--;
+	return true;
+}
+
+
+inline bool ThreadPool::trySteal(unsigned int index, Task& task)
+{
+	for (unsigned int i = 1; i < workers.size(); i++)
+	{
+		Worker& victim = *workers[(index + i) % workers.size()];
+		std::lock_guard<std::mutex> lock(victim.mutex);
+		if (victim.tasks.empty())
+			continue;
+		task = std::move(victim.tasks.front());
+		victim.tasks.pop_front();
+		numQueued--;
+		return true;
+	}
+	return false;
+}
+
+#endif // THREAD_POOL_HPP
@@ -0,0 +1,167 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <filesystem>
+#include <system_error>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "replay.hpp"
+#include "thread_pool.hpp"
+
+// Re-plays every replay in a directory headless, across all cores,
+// and checks that each one still ends with the score and lines it
+// recorded. Exits with 1 if any replay does not.
+
+enum class Verdict {
+	Match,
+	Mismatch,
+	// Unreadable, or not a well-formed replay
+	Invalid
+};
+
+struct ReplayCheck {
+	Verdict verdict {Verdict::Invalid};
+	ReplayInfo recorded;
+	ReplayInfo played;
+};
+
+ReplayCheck verifyFile(const std::string& path);
+
+int main(int argc, char* argv[])
+{
+	std::string dir;
+	unsigned int numThreads {0};
+	for (int i = 1; i < argc; i++)
+	{
+		const std::string arg {argv[i]};
+		try
+		{
+			if (arg == "--threads" && i + 1 < argc)
+			{
+				numThreads = std::stoul(argv[++i]);
+				continue;
+			}
+			if (dir.empty() && arg.rfind("--", 0) != 0)
+			{
+				dir = arg;
+				continue;
+			}
+		}
+		catch (const std::exception&)
+		{
+		}
+		dir.clear();
+		break;
+	}
+	if (dir.empty())
+	{
+		std::cerr << "Usage: " << argv[0] << " DIR [--threads N]\n";
+		return 2;
+	}
+
+	std::vector<std::string> paths;
+	std::error_code error;
+	for (const auto& entry : std::filesystem::directory_iterator{dir, error})
+	{
+		if (entry.is_regular_file())
+			paths.push_back(entry.path().string());
+	}
+	if (error)
+	{
+		std::cerr << "Could not read " << dir << ": " << error.message() << "\n";
+		return 2;
+	}
+	// Report in a fixed order whatever order the directory lists in
+	std::sort(paths.begin(), paths.end());
+
+	ThreadPool pool {numThreads};
+	// Every file writes only its own slot, so no locking is needed
+	std::vector<ReplayCheck> checks(paths.size());
+	constexpr std::size_t filesPerTask {64};
+
+	const auto timeStart = std::chrono::steady_clock::now();
+	for (std::size_t first = 0; first < paths.size(); first += filesPerTask)
+	{
+		const std::size_t last = std::min(first + filesPerTask, paths.size());
+		pool.submit([&paths, &checks, first, last] {
+			for (std::size_t i = first; i < last; i++)
+				checks[i] = verifyFile(paths[i]);
+		});
+	}
+	pool.wait();
+	const auto timeEnd = std::chrono::steady_clock::now();
+
+	unsigned long numMismatched {0};
+	unsigned long numInvalid {0};
+	unsigned long totalFrames {0};
+	for (std::size_t i = 0; i < paths.size(); i++)
+	{
+		const ReplayCheck& check = checks[i];
+		totalFrames += check.played.frames;
+		if (check.verdict == Verdict::Invalid)
+		{
+			numInvalid++;
+			std::cout << paths[i] << ": not a valid replay\n";
+		}
+		else if (check.verdict == Verdict::Mismatch)
+		{
+			numMismatched++;
+			std::cout << paths[i] << ": recorded score " << check.recorded.score
+				<< ", lines " << check.recorded.lines
+				<< ", frames " << check.recorded.frames
+				<< "; replayed score " << check.played.score
+				<< ", lines " << check.played.lines
+				<< ", frames " << check.played.frames << "\n";
+		}
+	}
+
+	const double seconds = std::chrono::duration<double>(timeEnd - timeStart).count();
+	std::cout << std::fixed << std::setprecision(2)
+		<< "replays:    " << paths.size() << " on " << pool.size() << " threads\n"
+		<< "time:       " << seconds << " s ("
+		<< paths.size() / seconds << " replays/s, "
+		<< totalFrames / seconds << " frames/s)\n"
+		<< "mismatched: " << numMismatched << "\n"
+		<< "invalid:    " << numInvalid << "\n";
+	return (numMismatched > 0 || numInvalid > 0) ? 1 : 0;
+}
+
+
+ReplayCheck verifyFile(const std::string& path)
+{
+	ReplayCheck check;
+	const int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+		return check;
+
+	struct stat info;
+	if (fstat(fd, &info) != 0 || info.st_size <= 0)
+	{
+		close(fd);
+		return check;
+	}
+
+	// The file is only read once, front to back
+	const auto size = static_cast<std::size_t>(info.st_size);
+	void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (mapping == MAP_FAILED)
+		return check;
+	madvise(mapping, size, MADV_SEQUENTIAL);
+
+	const auto* data = static_cast<const std::uint8_t*>(mapping);
+	if (playReplay(data, size, check.recorded, check.played))
+	{
+		const bool matches = check.played.score == check.recorded.score &&
+			check.played.lines == check.recorded.lines &&
+			check.played.frames == check.recorded.frames;
+		check.verdict = matches ? Verdict::Match : Verdict::Mismatch;
+	}
+	munmap(mapping, size);
+	return check;
+}